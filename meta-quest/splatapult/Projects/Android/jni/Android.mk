@@ -20,17 +20,27 @@ LOCAL_C_INCLUDES := \
 					$(ANDROID_VCPKG_DIR)/include \
 
 LOCAL_SRC_PATH := ../../../../../../../src
-LOCAL_SRC_FILES	:=  $(LOCAL_SRC_PATH)/core/debugrenderer.cpp \
+LOCAL_SRC_FILES	:=  $(LOCAL_SRC_PATH)/core/bluenoise.cpp \
+					$(LOCAL_SRC_PATH)/core/debugrenderer.cpp \
+					$(LOCAL_SRC_PATH)/core/framecapture.cpp \
+					$(LOCAL_SRC_PATH)/core/gpuprofiler.cpp \
 				    $(LOCAL_SRC_PATH)/core/image.cpp \
 					$(LOCAL_SRC_PATH)/core/log.cpp \
+					$(LOCAL_SRC_PATH)/core/memorytracker.cpp \
 					$(LOCAL_SRC_PATH)/core/program.cpp \
+					$(LOCAL_SRC_PATH)/core/startupreport.cpp \
+					$(LOCAL_SRC_PATH)/core/streambuffer.cpp \
 					$(LOCAL_SRC_PATH)/core/texture.cpp \
 					$(LOCAL_SRC_PATH)/core/util.cpp \
+					$(LOCAL_SRC_PATH)/core/viewuniforms.cpp \
 					$(LOCAL_SRC_PATH)/core/vertexbuffer.cpp \
 					$(LOCAL_SRC_PATH)/core/textrenderer.cpp \
+					$(LOCAL_SRC_PATH)/core/traceprofiler.cpp \
 					$(LOCAL_SRC_PATH)/core/xrbuddy.cpp \
 					$(LOCAL_SRC_PATH)/app.cpp \
+					$(LOCAL_SRC_PATH)/benchmark.cpp \
 					$(LOCAL_SRC_PATH)/android_main.cpp \
+					$(LOCAL_SRC_PATH)/camerarecording.cpp \
 					$(LOCAL_SRC_PATH)/camerasconfig.cpp \
 					$(LOCAL_SRC_PATH)/flycam.cpp \
 					$(LOCAL_SRC_PATH)/gaussiancloud.cpp \
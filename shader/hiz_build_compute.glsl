@@ -0,0 +1,32 @@
+/*%%HEADER%%*/
+
+// Builds one level of the hierarchical occluder depth used for splat occlusion culling.
+// Every texel keeps the farthest occluder depth of the texels it covers one level below.
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D srcDepthTexture;  // the whole pyramid, read at srcLevel
+uniform int srcLevel;
+layout(binding = 0, r32f) uniform highp writeonly image2D outDepthImage;
+
+void main() {
+  ivec2 outSize = imageSize(outDepthImage);
+  ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+  if (pixel.x >= outSize.x || pixel.y >= outSize.y) {
+    return;
+  }
+
+  // with an odd source size the last texel also covers the leftover row or column,
+  // the culling pass relies on that when it maps a rect into a level with a shift
+  ivec2 srcSize = textureSize(srcDepthTexture, srcLevel);
+  ivec2 extent = ivec2(2) + ivec2(equal(pixel, outSize - 1)) * (srcSize & 1);
+
+  float depth = 0.0;
+  for (int y = 0; y < extent.y; y++) {
+    for (int x = 0; x < extent.x; x++) {
+      ivec2 p = min(pixel * 2 + ivec2(x, y), srcSize - 1);
+      depth = max(depth, texelFetch(srcDepthTexture, p, srcLevel).r);
+    }
+  }
+  imageStore(outDepthImage, pixel, vec4(depth, 0.0, 0.0, 0.0));
+}
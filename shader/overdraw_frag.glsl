@@ -0,0 +1,34 @@
+/*%%HEADER%%*/
+
+// heatmap of the fragments the splat draws shaded per pixel, see OVERDRAW in the splat shaders
+
+layout(binding = 3, r32ui) uniform highp readonly uimage2D overdrawImage;
+
+// pixels per fragment count, the last bin holds every count from its index up
+layout(std430, binding = 0) buffer Histogram
+{
+    uint histogram[];
+};
+
+uniform float maxCount;  // shown red, the ramp is logarithmic
+
+layout(location = 0) out vec4 out_color;
+
+// black, blue, cyan, green, yellow, red
+vec3 ramp(float t)
+{
+    const vec3 colors[6] = vec3[6](vec3(0.0, 0.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 1.0),
+                                   vec3(0.0, 1.0, 0.0), vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0));
+    float x = clamp(t, 0.0, 1.0) * 5.0;
+    int i = min(int(x), 4);
+    return mix(colors[i], colors[i + 1], x - float(i));
+}
+
+void main()
+{
+    uint count = imageLoad(overdrawImage, ivec2(gl_FragCoord.xy)).r;
+    atomicAdd(histogram[min(count, uint(histogram.length() - 1))], 1u);
+
+    float t = log2(float(count) + 1.0) / log2(maxCount + 1.0);
+    out_color = vec4(ramp(t), 1.0);
+}
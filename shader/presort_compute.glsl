@@ -4,11 +4,12 @@
 */
 
 /*%%HEADER%%*/
+/*%%DEFINES%%*/
 
 layout(local_size_x = 256) in;
 
 uniform mat4 modelViewProj;
-uniform vec2 nearFar;
+uniform vec2 nearFar;  // y is the end of the sorted depth range
 uniform uint keyMax;
 
 layout(binding = 4, offset = 0) uniform atomic_uint output_count;
@@ -28,6 +29,16 @@ layout(std430, binding = 2) writeonly buffer OutputBuffer2
     uint indices[];
 };
 
+#ifdef HYBRID
+// splats beyond nearFar.y skip the sort, they are rendered stochastically
+layout(binding = 4, offset = 4) uniform atomic_uint far_count;
+
+layout(std430, binding = 3) writeonly buffer FarIndexBuffer
+{
+    uint farIndices[];
+};
+#endif
+
 void main()
 {
     uint idx = gl_GlobalInvocationID.x;
@@ -47,6 +58,13 @@ void main()
     const float CLIP = 1.5f;
     if (depth > 0.0f && xx < CLIP && xx > -CLIP && yy < CLIP && yy > -CLIP)
     {
+#ifdef HYBRID
+        if (depth >= nearFar.y)
+        {
+            farIndices[atomicCounterIncrement(far_count)] = idx;
+            return;
+        }
+#endif
         uint count = atomicCounterIncrement(output_count);
         // 16.16 fixed point
         //uint fixedPointZ = uint(0xffffffff) - uint(clamp(depth, 0.0f, 65535.0f) * 65536.0f);
@@ -0,0 +1,156 @@
+/*%%HEADER%%*/
+/*%%DEFINES%%*/
+
+// Per frame splat selection for the stochastic modes. Splats outside the current view are
+// dropped, with HIZ also splats hidden in the occluder depth pyramid of the previous frame,
+// and with SUBSAMPLE a random subset. The indices of the remaining splats are appended to the
+// element buffer and counted into the indirect draw command.
+
+layout(local_size_x = 256) in;
+
+/*%%VIEW_BLOCK%%*/
+uniform uint numSplats;
+uniform uint splatStride;     // interleaved gaussian data, everything in floats
+uniform uint posOffset;
+uniform uint cov0Offset;      // columns of the 3d covariance
+uniform uint cov1Offset;
+uniform uint cov2Offset;
+#ifdef HIZ
+uniform mat4 hizViewProjMat;  // view the depth pyramid was rendered from
+uniform bool occlusionTest;   // false while the pyramid is invalid, e.g. after a camera cut
+uniform int hizMaxLevel;
+uniform sampler2D hizTexture;
+#endif
+#ifdef SUBSAMPLE
+// a splat is kept with probability min(1, y * max(alpha, x)), keep in sync with splat_vert.glsl
+uniform vec2 subsampleParams;
+uniform uint frameSeed;
+#endif
+
+layout(std430, binding = 0) readonly buffer SplatData
+{
+    float splatData[];
+};
+
+layout(std430, binding = 1) writeonly buffer VisibleIndices
+{
+    uint visibleIndices[];
+};
+
+layout(std430, binding = 2) buffer DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    uint baseVertex;
+    uint baseInstance;
+};
+
+#ifdef SUBSAMPLE
+uint hash(uint x)
+{
+    x ^= x >> 16u;
+    x *= 0x7feb352du;
+    x ^= x >> 15u;
+    x *= 0x846ca68bu;
+    x ^= x >> 16u;
+    return x;
+}
+#endif
+
+void main()
+{
+    uint idx = gl_GlobalInvocationID.x;
+    if (idx >= numSplats)
+    {
+        return;
+    }
+
+    uint base = idx * splatStride;
+
+#ifdef SUBSAMPLE
+    // NOTE: alpha is encoded into the w component of the positions
+    float alpha = splatData[base + posOffset + 3u];
+    float keep = min(1.0, subsampleParams.y * max(alpha, subsampleParams.x));
+    if (float(hash(idx + frameSeed)) / 4294967296.0 >= keep)
+    {
+        return;
+    }
+#endif
+
+    vec3 pos = vec3(splatData[base + posOffset], splatData[base + posOffset + 1u], splatData[base + posOffset + 2u]);
+    // the geometry shader draws at most 3 sigma, the largest eigenvalue is bounded by the trace
+    float trace = splatData[base + cov0Offset] + splatData[base + cov1Offset + 1u] + splatData[base + cov2Offset + 2u];
+    float radius = 3.0 * sqrt(max(trace, 0.0));
+
+    // bound the sphere by its box, both for the current and the previous view
+    vec2 ndcMin = vec2(1e30);
+    vec2 ndcMax = vec2(-1e30);
+    bool crossesNear = false;
+#ifdef HIZ
+    vec2 hizMin = vec2(1e30);
+    vec2 hizMax = vec2(-1e30);
+    float hizNearest = 1e30;
+    bool crossesHizNear = false;
+#endif
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = pos + radius * vec3((i & 1) != 0 ? 1.0 : -1.0,
+                                          (i & 2) != 0 ? 1.0 : -1.0,
+                                          (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = view.viewProjMat * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+        {
+            crossesNear = true;
+        }
+        else
+        {
+            ndcMin = min(ndcMin, clip.xy / clip.w);
+            ndcMax = max(ndcMax, clip.xy / clip.w);
+        }
+
+#ifdef HIZ
+        vec4 hizClip = hizViewProjMat * vec4(corner, 1.0);
+        if (hizClip.w <= 0.0)
+        {
+            crossesHizNear = true;
+        }
+        else
+        {
+            vec3 ndc = hizClip.xyz / hizClip.w;
+            hizMin = min(hizMin, ndc.xy);
+            hizMax = max(hizMax, ndc.xy);
+            hizNearest = min(hizNearest, ndc.z);
+        }
+#endif
+    }
+
+    bool visible = crossesNear || (all(greaterThanEqual(ndcMax, vec2(-1.0))) && all(lessThanEqual(ndcMin, vec2(1.0))));
+
+#ifdef HIZ
+    if (visible && occlusionTest && !crossesHizNear)
+    {
+        vec2 uvMin = clamp(hizMin * 0.5 + 0.5, 0.0, 1.0);
+        vec2 uvMax = clamp(hizMax * 0.5 + 0.5, 0.0, 1.0);
+        ivec2 size = textureSize(hizTexture, 0);
+        vec2 extent = (uvMax - uvMin) * vec2(size);
+
+        // the level where the rect covers at most 2x2 texels
+        int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, hizMaxLevel);
+        ivec2 levelSize = textureSize(hizTexture, level);
+        ivec2 p0 = min(ivec2(uvMin * vec2(size)) >> level, levelSize - 1);
+        ivec2 p1 = min(ivec2(uvMax * vec2(size)) >> level, levelSize - 1);
+
+        float occluder = max(max(texelFetch(hizTexture, p0, level).r,
+                                 texelFetch(hizTexture, ivec2(p1.x, p0.y), level).r),
+                             max(texelFetch(hizTexture, ivec2(p0.x, p1.y), level).r,
+                                 texelFetch(hizTexture, p1, level).r));
+        visible = hizNearest * 0.5 + 0.5 <= occluder;
+    }
+#endif
+
+    if (visible)
+    {
+        visibleIndices[atomicAdd(count, 1u)] = idx;
+    }
+}
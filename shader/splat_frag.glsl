@@ -6,6 +6,7 @@
 */
 
 /*%%HEADER%%*/
+/*%%DEFINES%%*/
 
 in vec4 frag_color;  // radiance of splat
 in vec3 frag_cov2inv;  // inverse of the 2D screen space covariance matrix of the guassian
@@ -13,8 +14,17 @@ in vec2 frag_p;  // 2D screen space center of the guassian
 
 out vec4 out_color;
 
+#ifdef OVERDRAW
+// fragments shaded per pixel, the side effect also turns off early depth testing
+layout(binding = 3, r32ui) uniform highp coherent uimage2D overdrawImage;
+#endif
+
 void main()
 {
+#ifdef OVERDRAW
+    imageAtomicAdd(overdrawImage, ivec2(gl_FragCoord.xy), 1u);
+#endif
+
     vec2 d = gl_FragCoord.xy - frag_p;
 
     float g =
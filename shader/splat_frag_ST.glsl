@@ -3,14 +3,31 @@
 */
 
 /*%%HEADER%%*/
+/*%%DEFINES%%*/
 
 layout(location = 0) in vec4 frag_color;    // Radiance of the splat (passed from geometry shader)
 layout(location = 1) in vec3 frag_cov2inv;  // Inverse of the 2D screen space covariance matrix
 layout(location = 2) in vec2 frag_p;        // 2D screen space center of the Gaussian
 
-uniform uint u_randomSeed;
+/*%%VIEW_BLOCK%%*/  // frameIndex and randomSeed change with every stochastic draw
+uniform int u_noiseType;         // 0 = white noise, 1 = blue noise, 2 = scrambled sobol
+uniform sampler2D u_blueNoise;   // tileable blue noise dither mask
 
-out vec4 out_color;  // Final pixel color output
+#define NOISE_WHITE 0
+#define NOISE_BLUE 1
+#define NOISE_SOBOL 2
+
+layout(location = 0) out vec4 out_color;  // Final pixel color output
+#ifdef HIZ
+// depth of fragments that hide everything behind them, base level of the occlusion culling pyramid
+layout(location = 1) out float out_occluder;
+#define OCCLUDER_ALPHA 0.98
+#endif
+
+#ifdef OVERDRAW
+// fragments shaded per pixel, the side effect also turns off early depth testing
+layout(binding = 3, r32ui) uniform highp coherent uimage2D overdrawImage;
+#endif
 
 const float THRESHOLD = 1.0 / 255.0;
 
@@ -25,23 +42,68 @@ uint hash(uint x) {
 }
 
 
-float randomUniform(uint seed_in) {
+float randomUniform(uint seed_in, uint sample_id) {
     // Ensure random value is de-correlated wrt screen space coordinates, MSAA
     // sample ID, and splat. Try to pack intergers for all these into a 32 bit
     // value, hash, then normalize to [0, 1].
 
     uint seed = uint(gl_FragCoord.x);
     seed ^= uint(gl_FragCoord.y) << 20u;
-#ifdef GL_ARB_sample_shading
-    seed ^= uint(gl_SampleID) << 8u;
-#endif
+    seed ^= sample_id << 8u;
     seed += uint(gl_PrimitiveID);
     seed += seed_in;
     return float(hash(seed)) / 4294967295.0;
 }
 
 
+// Owen scrambling via a hash based Laine-Karras permutation, see Burley 2020,
+// "Practical Hash-based Owen Scrambling".
+uint laineKarrasPermutation(uint x, uint seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint primitiveSeed() {
+    uint seed = uint(gl_FragCoord.x);
+    seed ^= uint(gl_FragCoord.y) << 16u;
+    return hash(seed + hash(uint(gl_PrimitiveID)));
+}
+
+float randomValue(uint sample_id) {
+#ifdef SAMPLE_MASK
+    const uint samplesPerFrame = uint(NUM_SAMPLES);
+#else
+    const uint samplesPerFrame = 1u;
+#endif
+    if (u_noiseType == NOISE_BLUE) {
+        // Spatial blue noise, animated over frames with the golden ratio sequence so every
+        // frame stays blue. A per splat rotation decorrelates overlapping splats.
+        ivec2 size = textureSize(u_blueNoise, 0);
+        float noise = texelFetch(u_blueNoise, ivec2(gl_FragCoord.xy) & (size - 1), 0).r;
+        uint frame = view.frameIndex * samplesPerFrame + sample_id;
+        float offset = float(frame * 2654435769u) / 4294967296.0;
+        float rotation = float(hash(uint(gl_PrimitiveID) ^ (sample_id << 24u))) / 4294967296.0;
+        return fract(noise + offset + rotation);
+    } else if (u_noiseType == NOISE_SOBOL) {
+        // First sobol dimension over frames, independently owen scrambled per pixel and splat,
+        // so the thresholds a pixel sees for a splat are stratified in time. The sobol point is
+        // the bit reversed index and the scramble works on reversed bits, the reversals cancel.
+        uint index = view.frameIndex * samplesPerFrame + sample_id;
+        uint v = bitfieldReverse(laineKarrasPermutation(index, primitiveSeed()));
+        return float(v >> 8u) / 16777216.0;
+    }
+    return randomUniform(view.randomSeed, sample_id);
+}
+
 void main() {
+#ifdef OVERDRAW
+    imageAtomicAdd(overdrawImage, ivec2(gl_FragCoord.xy), 1u);
+#endif
+
     const vec2 d = gl_FragCoord.xy - frag_p;  // Distance from Gaussian center
 
     const float exponent = d.x * d.x * frag_cov2inv.x +
@@ -54,10 +116,36 @@ void main() {
         discard;
 
 
-    float randomVal = randomUniform(u_randomSeed);
+#ifdef SAMPLE_MASK
+    // Shade once per pixel, but keep or drop each MSAA sample with its own
+    // threshold, the hardware resolve then averages NUM_SAMPLES decisions.
+    int mask = 0;
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        if (randomValue(uint(i)) < alpha)
+            mask |= 1 << i;
+    }
+
+    if (mask == 0)
+        discard;
+
+    gl_SampleMask[0] = mask;
+    out_color = vec4(frag_color.rgb, 1.0);
+#else
+#ifdef GL_ARB_sample_shading
+    float randomVal = randomValue(uint(gl_SampleID));
+#else
+    float randomVal = randomValue(0u);
+#endif
 
     if (randomVal < alpha)
         out_color = vec4(frag_color.rgb, 1.0);
     else
         discard;
+#endif
+
+#ifdef HIZ
+    // a translucent fragment may be dropped next frame and reveal what is behind it,
+    // the far plane keeps that pixel from culling anything
+    out_occluder = alpha >= OCCLUDER_ALPHA ? gl_FragCoord.z : 1.0;
+#endif
 }
\ No newline at end of file
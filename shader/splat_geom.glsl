@@ -7,7 +7,7 @@
 
 /*%%HEADER%%*/
 
-uniform vec3 projParams;  // x, y, WIDTH, HEIGHT
+/*%%VIEW_BLOCK%%*/
 
 layout(points) in;
 layout(triangle_strip, max_vertices = 4) out;
@@ -30,8 +30,8 @@ void main()
     // Pass along primitive ID so the fragment shader can randomize wrt to it.
     gl_PrimitiveID = gl_PrimitiveIDIn;
 
-    float WIDTH = projParams.x;
-    float HEIGHT = projParams.y;
+    float WIDTH = view.viewport.z;
+    float HEIGHT = view.viewport.w;
 
     float w = gl_in[0].gl_Position.w;
     vec2 scaleFactors = vec2((2.0f / WIDTH) * w, (2.0f / HEIGHT) * w);
@@ -6,11 +6,13 @@
 
 /*%%DEFINES%%*/
 
-uniform mat4 viewMat;  // used to project position into view coordinates.
-uniform mat4 projMat;  // used to project view coordinates into clip coordinates.
-uniform mat4 invProjMat;
-uniform vec3 projParams;  // x = HEIGHT / tan(FOVY / 2), y = Z_NEAR, z = Z_FAR
-uniform vec3 eye;
+// view.viewMat projects position into view coordinates, view.projMat view into clip coordinates
+/*%%VIEW_BLOCK%%*/
+#ifdef SUBSAMPLE
+// the culling pass keeps a splat with probability min(1, y * max(alpha, x)), dividing the
+// alpha by it leaves the expected coverage of the stochastic alpha test unchanged
+uniform vec2 subsampleParams;
+#endif
 
 in vec4 position;  // center of the gaussian in object coordinates, (with alpha
                    // crammed in to w
@@ -195,31 +197,35 @@ float adjust(float a, float epsilon = 1e-12) {
 }
 
 void main(void) {
+#ifdef SUBSAMPLE
+  const float alpha = min(position.w / max(min(1.0, subsampleParams.y * max(position.w, subsampleParams.x)), 1e-6), 1.0);
+#else
   const float alpha = position.w;
-  vec4 positionInView = viewMat * vec4(position.xyz, 1.0f);
-  vec4 positionInScreen = projMat * positionInView;
+#endif
+  vec4 positionInView = view.viewMat * vec4(position.xyz, 1.0f);
+  vec4 positionInScreen = view.projMat * positionInView;
 
-  float WIDTH = projParams.x;
-  float HEIGHT = projParams.y;
+  float WIDTH = view.viewport.z;
+  float HEIGHT = view.viewport.w;
 
   // J is the jacobian of the projection and viewport transformations.
   // this is an affine approximation of the real projection.
   // because gaussians are closed under affine transforms.
-  float SX = projMat[0][0] * WIDTH;
-  float SY = projMat[1][1] * HEIGHT;
+  float SX = view.projMat[0][0] * WIDTH;
+  float SY = view.projMat[1][1] * HEIGHT;
   float tzSq = positionInView.z * positionInView.z;
   float jsx = -SX / (2.0f * positionInView.z);
   float jsy = -SY / (2.0f * positionInView.z);
   float jtx = (SX * positionInView.x) / (2.0f * tzSq);
   float jty = (SY * positionInView.y) / (2.0f * tzSq);
-  float jtz = projParams.z / (2.0f * tzSq);
+  float jtz = ((view.nearFar.x - view.nearFar.y) * view.projMat[3][2]) / (2.0f * tzSq);
   mat3 J =
       mat3(vec3(jsx, 0.0f, 0.0f), vec3(0.0f, jsy, 0.0f), vec3(jtx, jty, jtz));
 
   // combine the affine transforms of W (viewMat) and J (approx of viewportMat *
   // projMat) using the fact that the new transformed covariance matrix V_Prime
   // = JW * V * (JW)^T
-  mat3 W = mat3(viewMat);
+  mat3 W = mat3(view.viewMat);
   mat3 V = mat3(cov3_col0, cov3_col1, cov3_col2);
   mat3 JW = J * W;
   mat3 V_prime = JW * V * transpose(JW);
@@ -324,7 +330,7 @@ void main(void) {
   geom_p.y = 0.5f * HEIGHT * (1.0f + geom_p.y);
 
   // compute radiance from sh
-  vec3 v = normalize(position.xyz - eye);
+  vec3 v = normalize(position.xyz - view.eye.xyz);
   geom_color = vec4(ComputeRadianceFromSH(v), alpha);
 
 #ifdef FRAMEBUFFER_SRGB
@@ -356,7 +362,7 @@ void main(void) {
   mat3 vcov3 = W * V * transpose(W);
   mat3 inv_vcov3 = inverse(vcov3);
   vec4 plane = approximate_plane(positionInView.xyz, inv_vcov3);
-  mat4 inv_proj = inverse(projMat);
+  mat4 inv_proj = view.invProjMat;
 
   float adjPosW = adjust(gl_Position.w);
 
@@ -386,7 +392,7 @@ void main(void) {
     float t = -plane.w / denom; 
 
     // Project intersection point back to clip space
-    vec4 clip_pos = projMat * vec4(t * ray_dir, 1.0);
+    vec4 clip_pos = view.projMat * vec4(t * ray_dir, 1.0);
 
     // Store the corner with original w, but new z
     geom_corners[i] = vec4(corner.xy, clip_pos.z / clip_pos.w * corner.w, corner.w);
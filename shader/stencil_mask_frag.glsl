@@ -0,0 +1,40 @@
+/*%%HEADER%%*/
+
+// Marks the pixels whose TAA history has not converged yet, everything else is discarded
+// so only the marked pixels end up in the stencil buffer.
+
+// keep in sync with taa_resolve_compute.glsl
+#define MAX_SAMPLES 128.0
+#define MIN_SAMPLES 4.0
+
+uniform sampler2D historyColorTexture;   // Latest average, sample count in alpha
+uniform sampler2D historyMomentTexture;  // Running mean of the squared luminance
+uniform float varianceThreshold;
+
+out vec4 out_Color;
+
+float luminance(vec3 c) {
+  return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+bool needsSamples(vec4 history, float moment) {
+  float n = history.w;
+  if (n <= 0.0 || n >= MAX_SAMPLES) {
+    return false;
+  }
+  if (n < MIN_SAMPLES) {
+    return true;
+  }
+  float mean = luminance(history.rgb);
+  return max(moment - mean * mean, 0.0) / n > varianceThreshold;
+}
+
+void main() {
+  ivec2 pixel = ivec2(gl_FragCoord.xy);
+  vec4 history = texelFetch(historyColorTexture, pixel, 0);
+  float moment = texelFetch(historyMomentTexture, pixel, 0).r;
+  if (!needsSamples(history, moment)) {
+    discard;
+  }
+  out_Color = vec4(0.0);
+}
@@ -0,0 +1,191 @@
+/*%%HEADER%%*/
+/*%%DEFINES%%*/
+/*%%VIEW_BLOCK%%*/
+
+// Fused TAA resolve: reproject the history into the current view, clamp it against the
+// current frame and blend. The new history is also the image that gets presented.
+
+#define TILE_SIZE 8
+#define TILE_BORDER (TILE_SIZE + 2)
+
+// how many standard deviations of the current neighbourhood the history may stray from
+#define CLAMP_GAMMA 2.0
+
+#ifdef ADAPTIVE_SAMPLES
+// keep in sync with stencil_mask_frag.glsl
+#define MAX_SAMPLES 128.0
+#define MIN_SAMPLES 4.0
+#endif
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+uniform sampler2D currentColorTexture;  // Current color texture
+uniform sampler2D currentDepthTexture;  // Current depth texture (normalized depth)
+uniform sampler2D historyColorTexture;  // Previous average, sample count in alpha (bilinear)
+#ifdef COMPACT_TAA
+uniform sampler2D historyDepthTexture;  // Previous eye depth
+uniform vec2 depthParams;               // projMat[2][2], projMat[3][2]
+uniform mat4 prevInvProjViewMat;
+layout(binding = 0, rgba16f) uniform highp writeonly image2D outColorImage;
+layout(binding = 1, r32f) uniform highp writeonly image2D outPosImage;
+#else
+uniform sampler2D historyXYZTexture;    // Previous world coordinates
+layout(binding = 0, rgba32f) uniform highp writeonly image2D outColorImage;
+layout(binding = 1, rgba32f) uniform highp writeonly image2D outPosImage;
+#endif
+#ifdef ADAPTIVE_SAMPLES
+uniform sampler2D historyMomentTexture;  // Running mean of the squared luminance
+uniform float varianceThreshold;         // max variance of the mean luminance of a converged pixel
+uniform bool refine;                     // only pixels that still need samples got a new one
+layout(binding = 2, r32f) uniform highp writeonly image2D outMomentImage;
+#endif
+uniform bool viewChanged;
+uniform bool historyValid;
+uniform mat4 prevProjViewMat;
+
+// current frame colors of this workgroup plus a one pixel border
+shared vec3 tile[TILE_BORDER * TILE_BORDER];
+
+// variance clip the history against the 3x3 neighbourhood of the current frame
+vec3 clampHistory(vec3 history) {
+  ivec2 center = ivec2(gl_LocalInvocationID.xy) + 1;
+  vec3 m1 = vec3(0.0);
+  vec3 m2 = vec3(0.0);
+  for (int y = -1; y <= 1; y++) {
+    for (int x = -1; x <= 1; x++) {
+      vec3 c = tile[(center.y + y) * TILE_BORDER + center.x + x];
+      m1 += c;
+      m2 += c * c;
+    }
+  }
+  vec3 mean = m1 / 9.0;
+  vec3 sigma = sqrt(max(m2 / 9.0 - mean * mean, vec3(0.0)));
+  return clamp(history, mean - CLAMP_GAMMA * sigma, mean + CLAMP_GAMMA * sigma);
+}
+
+#ifdef ADAPTIVE_SAMPLES
+float luminance(vec3 c) {
+  return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+bool needsSamples(vec4 history, float moment) {
+  float n = history.w;
+  if (n <= 0.0 || n >= MAX_SAMPLES) {
+    return false;
+  }
+  if (n < MIN_SAMPLES) {
+    return true;
+  }
+  float mean = luminance(history.rgb);
+  return max(moment - mean * mean, 0.0) / n > varianceThreshold;
+}
+#endif
+
+void main() {
+  ivec2 size = textureSize(currentColorTexture, 0);
+
+  // cooperatively load the tile, every invocation fetches at most two texels
+  ivec2 tileOrigin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE - 1;
+  for (int i = int(gl_LocalInvocationIndex); i < TILE_BORDER * TILE_BORDER; i += TILE_SIZE * TILE_SIZE) {
+    ivec2 p = clamp(tileOrigin + ivec2(i % TILE_BORDER, i / TILE_BORDER), ivec2(0), size - 1);
+    tile[i] = texelFetch(currentColorTexture, p, 0).rgb;
+  }
+  barrier();
+
+  ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+  if (pixel.x >= size.x || pixel.y >= size.y) {
+    return;
+  }
+  vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+
+  float depth = texelFetch(currentDepthTexture, pixel, 0).r;
+  float zClip = depth * 2.0 - 1.0;
+  vec4 worldCoords = view.invViewProjMat * vec4(2.0f * uv - 1.0f, zClip, 1.0);
+  worldCoords /= worldCoords.w;
+  vec4 currentColor = vec4(tile[(int(gl_LocalInvocationID.y) + 1) * TILE_BORDER + int(gl_LocalInvocationID.x) + 1], 1.0);
+#ifdef COMPACT_TAA
+  // eye depth, the clip w of this pixel
+  float currentEyeDepth = depthParams.y / (zClip + depthParams.x);
+#endif
+
+  // motion vector from the current depth and the previous view
+  vec2 historyUV = uv;
+  if (viewChanged) {
+    vec4 prevCoords = prevProjViewMat * worldCoords;
+    historyUV = (prevCoords.xy / prevCoords.w) * 0.5 + 0.5;
+  }
+  bool onScreen = historyUV.x >= 0.0 && historyUV.x <= 1.0 && historyUV.y >= 0.0 && historyUV.y <= 1.0;
+
+  vec4 historyColor = textureLod(historyColorTexture, historyUV, 0.0);
+#ifdef COMPACT_TAA
+  float historyEyeDepth = textureLod(historyDepthTexture, historyUV, 0.0).r;
+  vec4 prevUVDepth = vec4((2.0f * historyUV - 1.0f) * historyEyeDepth,
+                          -depthParams.x * historyEyeDepth + depthParams.y,
+                          historyEyeDepth);
+  vec4 historyPos = prevInvProjViewMat * prevUVDepth;
+  vec3 historyXYZ = historyPos.xyz / historyPos.w;
+  // history depth as seen from the current view
+  historyEyeDepth = (view.viewProjMat * vec4(historyXYZ, 1.0)).w;
+#else
+  vec3 historyXYZ = textureLod(historyXYZTexture, historyUV, 0.0).rgb;
+#endif
+  float distance = length(worldCoords.xyz - historyXYZ);
+
+#ifdef ADAPTIVE_SAMPLES
+  float historyMoment = textureLod(historyMomentTexture, historyUV, 0.0).r;
+  if (refine && !needsSamples(historyColor, historyMoment)) {
+    // outside the stencil mask, there is no new sample, pass the history through
+#ifdef COMPACT_TAA
+    imageStore(outPosImage, pixel, textureLod(historyDepthTexture, uv, 0.0));
+#else
+    imageStore(outPosImage, pixel, textureLod(historyXYZTexture, uv, 0.0));
+#endif
+    imageStore(outMomentImage, pixel, vec4(historyMoment, 0.0, 0.0, 0.0));
+    imageStore(outColorImage, pixel, historyColor);
+    return;
+  }
+  float currentMoment = luminance(currentColor.rgb);
+  currentMoment *= currentMoment;
+#endif
+
+  // alpha > 0 means this history texel has accumulated samples
+  bool hasValidHistory = historyValid && onScreen && historyColor.w > 0.0;
+  bool shouldUseTemporalData = hasValidHistory && (!viewChanged || distance < 100.0);
+
+  vec4 outColor;
+  if (shouldUseTemporalData) {
+    if (viewChanged) {
+      historyColor.xyz = clampHistory(historyColor.xyz);
+    }
+    float alpha = min(historyColor.w, 128.0);
+#ifdef COMPACT_TAA
+    float outDepth = (alpha / (alpha + 1.0)) * historyEyeDepth +
+                     (1.0f / (alpha + 1.0)) * currentEyeDepth;
+    imageStore(outPosImage, pixel, vec4(outDepth, 0.0, 0.0, 0.0));
+#else
+    vec3 outXYZ = (alpha / (alpha + 1.0)) * historyXYZ +
+                  (1.0f / (alpha + 1.0)) * worldCoords.xyz;
+    imageStore(outPosImage, pixel, vec4(outXYZ, 1.0));
+#endif
+    outColor.xyz = (alpha / (alpha + 1.0)) * historyColor.xyz +
+                   (1.0f / (alpha + 1.0)) * currentColor.xyz;
+    outColor.w = min(alpha + 1.0, 128.0);
+#ifdef ADAPTIVE_SAMPLES
+    imageStore(outMomentImage, pixel, vec4((alpha / (alpha + 1.0)) * historyMoment +
+                                           (1.0f / (alpha + 1.0)) * currentMoment, 0.0, 0.0, 0.0));
+#endif
+  } else {
+    // No valid temporal data - start fresh with current frame
+#ifdef COMPACT_TAA
+    imageStore(outPosImage, pixel, vec4(currentEyeDepth, 0.0, 0.0, 0.0));
+#else
+    imageStore(outPosImage, pixel, worldCoords);
+#endif
+    outColor = currentColor;
+    outColor.w = 1.0;  // Start accumulation from 1
+#ifdef ADAPTIVE_SAMPLES
+    imageStore(outMomentImage, pixel, vec4(currentMoment, 0.0, 0.0, 0.0));
+#endif
+  }
+  imageStore(outColorImage, pixel, outColor);
+}
@@ -461,6 +461,8 @@ void android_main(struct android_app* androidApp)
         }
     }
 
+    app.Shutdown();
+
     // TODO: DESTROY STUFF
     Log::D("Finished!\n");
 
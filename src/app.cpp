@@ -16,26 +16,36 @@
 #include <SDL2/SDL.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
+#include <future>
+#include <limits>
 #include <thread>
 
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
-#else
-#define ZoneScoped
-#define ZoneScopedNC(NAME, COLOR)
 #endif
 
 #include "core/framebuffer.h"
 #include "core/log.h"
 #include "core/debugrenderer.h"
+#include "core/framecapture.h"
+#include "core/gpuprofiler.h"
 #include "core/inputbuddy.h"
+#include "core/memorytracker.h"
 #include "core/optionparser.h"
+#include "core/program.h"
+#include "core/startupreport.h"
+#include "core/streambuffer.h"
 #include "core/textrenderer.h"
 #include "core/texture.h"
+#include "core/traceprofiler.h"
 #include "core/util.h"
 #include "core/xrbuddy.h"
 
+#include "benchmark.h"
+#include "camerarecording.h"
 #include "camerasconfig.h"
 #include "camerapathrenderer.h"
 #include "flycam.h"
@@ -75,6 +85,9 @@ const option::Descriptor usage[] =
 const float Z_NEAR = 0.1f;
 const float Z_FAR = 1000.0f;
 const float FOVY = glm::radians(45.0f);
+const uint32_t BENCHMARK_SEED = 1234;
+// added to the frame number, srand() is called with it before every recorded frame
+const uint32_t RECORD_SEED = 1234;
 
 const float MOVE_SPEED = 2.5f;
 const float ROT_SPEED = 1.15f;
@@ -82,6 +95,16 @@ const float ROT_SPEED = 1.15f;
 const glm::vec4 WHITE = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 const glm::vec4 BLACK = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 const int TEXT_NUM_ROWS = 25;
+// per frame geometry of the debug and text renderers
+const size_t STREAM_BUFFER_REGION_SIZE = 1024 * 1024;
+
+// accepted by --render_mode, cycled through with m
+const std::vector<std::string> RENDER_MODES = {
+    "ST",
+    "ST-popfree",
+    "AB",
+    "hybrid"
+};
 
 #include <string>
 #include <filesystem>
@@ -213,8 +236,39 @@ static void RenderDesktop(glm::ivec2 windowSize, std::shared_ptr<Program> deskto
     }
 }
 
+static std::shared_ptr<CamerasConfig> LoadCamerasConfig(const std::string& jsonFilename)
+{
+    TraceProfiler::SetThreadName("config loader");
+    StartupReport::SetThreadName("config loader");
+    StartupReport::Phase phase("config load");
+    auto camerasConfig = std::make_shared<CamerasConfig>();
+    if (!camerasConfig->ImportJson(jsonFilename))
+    {
+        Log::W("Error loading cameras.json\n");
+        return nullptr;
+    }
+    return camerasConfig;
+}
+
+static std::shared_ptr<VrConfig> LoadVrConfig(const std::string& jsonFilename)
+{
+    TraceProfiler::SetThreadName("config loader");
+    StartupReport::SetThreadName("config loader");
+    StartupReport::Phase phase("config load");
+    auto vrConfig = std::make_shared<VrConfig>();
+    if (!vrConfig->ImportJson(jsonFilename))
+    {
+        Log::I("Could not load vr.json\n");
+        return nullptr;
+    }
+    return vrConfig;
+}
+
 static std::shared_ptr<PointCloud> LoadPointCloud(const std::string& plyFilename, bool useLinearColors)
 {
+    TraceProfiler::SetThreadName("point cloud loader");
+    StartupReport::SetThreadName("point cloud loader");
+    StartupReport::Phase phase("point cloud load");
     auto pointCloud = std::make_shared<PointCloud>(useLinearColors);
 
     if (!pointCloud->ImportPly(plyFilename))
@@ -227,6 +281,8 @@ static std::shared_ptr<PointCloud> LoadPointCloud(const std::string& plyFilename
 
 static std::shared_ptr<GaussianCloud> LoadGaussianCloud(const std::string& plyFilename, const App::Options& opt)
 {
+    TraceProfiler::SetThreadName("ply loader");
+    StartupReport::SetThreadName("ply loader");
     GaussianCloud::Options options = {0};
 #ifdef __ANDROID__
     options.importFullSH = false;
@@ -258,6 +314,14 @@ Desktop Controls\n\
 * c - toggle between initial SfM point cloud (if present) and gaussian splats.\n\
 * n - jump to next camera\n\
 * p - jump to previous camera\n\
+* b - cycle the random source of the stochastic modes (white, blue, sobol)\n\
+* m - cycle the render mode (ST, ST-popfree, AB, hybrid)\n\
+* F1 - show hide the text overlay\n\
+* F2 - show hide the gpu time of each render stage\n\
+* F3 - write a chrome trace of the next frames, see --trace\n\
+* F4 - show hide the overdraw heatmap\n\
+* F5 - start stop a frame capture, see --capture\n\
+* F6 - show hide the memory used by each subsystem and the driver's video memory\n\
 \n\
 VR Controls\n\
 ---------------\n\
@@ -310,19 +374,13 @@ App::ParseResult App::ParseArguments(int argc, const char* argv[])
         continue;
       }
 
-      const std::vector<std::string> validRenderModes = {
-        "ST",
-        "ST-popfree",
-        "AB"
-      };
-
       if (strcmp(argv[i], "--render_mode") == 0 && i + 1 < argc) {
         std::string mode = argv[i + 1];
         // Check if mode is in validRenderModes
-        if (std::find(validRenderModes.begin(), validRenderModes.end(), mode) == validRenderModes.end()) {
+        if (std::find(RENDER_MODES.begin(), RENDER_MODES.end(), mode) == RENDER_MODES.end()) {
           std::cerr << "Error: Invalid value for --render_mode: " << mode << std::endl;
           std::cerr << "Valid options are:";
-          for (const auto& opt : validRenderModes) std::cerr << " " << opt;
+          for (const auto& opt : RENDER_MODES) std::cerr << " " << opt;
           std::cerr << std::endl;
           exit(EXIT_FAILURE);
         }
@@ -334,6 +392,141 @@ App::ParseResult App::ParseArguments(int argc, const char* argv[])
         opt.taa = false;
         continue;
       }
+      if (strcmp(argv[i], "--compact-taa") == 0) {
+        opt.compactTaa = true;
+        continue;
+      }
+      if (strcmp(argv[i], "--adaptive-samples") == 0 && i + 1 < argc) {
+        opt.adaptiveSamples = atoi(argv[i + 1]);
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--sample-mask") == 0) {
+        opt.sampleMask = true;
+        continue;
+      }
+      if (strcmp(argv[i], "--hiz") == 0) {
+        opt.hiz = true;
+        continue;
+      }
+      if (strcmp(argv[i], "--no-shader-cache") == 0) {
+        opt.shaderCache = false;
+        continue;
+      }
+      if (strcmp(argv[i], "--splat-budget") == 0 && i + 1 < argc) {
+        opt.splatBudget = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--idle") == 0) {
+        opt.idle = true;
+        continue;
+      }
+
+      // in the order of splat::SplatRenderer::NoiseType
+      const std::vector<std::string> validNoiseTypes = {
+        "white",
+        "blue",
+        "sobol"
+      };
+
+      if (strcmp(argv[i], "--noise") == 0 && i + 1 < argc) {
+        std::string noise = argv[i + 1];
+        auto iter = std::find(validNoiseTypes.begin(), validNoiseTypes.end(), noise);
+        if (iter == validNoiseTypes.end()) {
+          std::cerr << "Error: Invalid value for --noise: " << noise << std::endl;
+          std::cerr << "Valid options are:";
+          for (const auto& opt : validNoiseTypes) std::cerr << " " << opt;
+          std::cerr << std::endl;
+          exit(EXIT_FAILURE);
+        }
+        opt.noiseType = (int)(iter - validNoiseTypes.begin());
+        i++;
+        continue;
+      }
+      if (strcmp(argv[i], "--hybrid-near") == 0 && i + 1 < argc) {
+        opt.hybridNearDepth = (float)atof(argv[i + 1]);
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--convergence-test") == 0 && i + 1 < argc) {
+        opt.convergenceFrames = atoi(argv[i + 1]);
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--convergence-motion") == 0) {
+        opt.convergenceMotion = true;
+        continue;
+      }
+      if (strcmp(argv[i], "--gpu-profile") == 0) {
+        opt.gpuProfile = true;
+        continue;
+      }
+      if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+        opt.benchmarkFilename = argv[i + 1];
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--benchmark-warmup") == 0 && i + 1 < argc) {
+        opt.benchmarkWarmupFrames = atoi(argv[i + 1]);
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--benchmark-frames") == 0 && i + 1 < argc) {
+        opt.benchmarkFramesPerCamera = atoi(argv[i + 1]);
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--overdraw") == 0) {
+        opt.overdrawHeatmap = true;
+        continue;
+      }
+      if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+        opt.traceFilename = argv[i + 1];
+        opt.traceStartFrame = std::max(opt.traceStartFrame, 0);
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--trace-start") == 0 && i + 1 < argc) {
+        opt.traceStartFrame = std::max(atoi(argv[i + 1]), 0);
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--trace-frames") == 0 && i + 1 < argc) {
+        opt.traceFrameCount = std::max(atoi(argv[i + 1]), 1);
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+        opt.recordFilename = argv[i + 1];
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+        opt.replayFilename = argv[i + 1];
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+        opt.capture = true;
+        opt.captureFilename = argv[i + 1];
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--capture-pipe") == 0 && i + 1 < argc) {
+        opt.capture = true;
+        opt.capturePipe = argv[i + 1];
+        i++; // skip the next argument
+        continue;
+      }
+      if (strcmp(argv[i], "--startup-report") == 0) {
+        opt.startupReport = true;
+        continue;
+      }
+      if (strcmp(argv[i], "--keep-cpu-data") == 0) {
+        opt.keepCpuData = true;
+        continue;
+      }
 
     }
     option::Stats stats(usage, argc, argv);
@@ -402,12 +595,54 @@ App::ParseResult App::ParseArguments(int argc, const char* argv[])
 
     Log::SetLevel(opt.debugLogging ? Log::Debug : Log::Warning);
 
+    if (opt.sampleMask && sampleCount > 32) {
+        sampleCount = 32;
+        std::cout << "Info: --sample-mask supports at most 32 samples." << std::endl;
+    }
+
     // [TODO] When samples > 1, turn off TAA
     if (sampleCount > 1) {
         opt.taa = false;
         std::cout << "Info: TAA is disabled when using multiple samples." << std::endl;
     }
 
+    if (!opt.benchmarkFilename.empty())
+    {
+        if (opt.vrMode)
+        {
+            Log::E("--benchmark is not supported in vr mode\n");
+            return ERROR_RESULT;
+        }
+        // only the splats are timed, every frame is rendered
+        opt.idle = false;
+        opt.drawDebug = false;
+        opt.drawFps = false;
+    }
+
+    if (!opt.replayFilename.empty())
+    {
+        if (opt.vrMode)
+        {
+            Log::E("--replay is not supported in vr mode, the headset decides the views\n");
+            return ERROR_RESULT;
+        }
+        if (!opt.recordFilename.empty())
+        {
+            Log::E("--record and --replay can not be combined\n");
+            return ERROR_RESULT;
+        }
+        // every recorded frame is rendered once
+        opt.idle = false;
+    }
+
+    if (opt.capture)
+    {
+        // a video needs every frame, without the overlays
+        opt.idle = false;
+        opt.drawDebug = false;
+        opt.drawFps = false;
+    }
+
     std::filesystem::path plyPath(plyFilename);
     if (!std::filesystem::exists(plyPath) || !std::filesystem::is_regular_file(plyPath))
     {
@@ -420,6 +655,16 @@ App::ParseResult App::ParseArguments(int argc, const char* argv[])
 
 bool App::Init()
 {
+    // ends once the first frame is rendered
+    StartupReport::Begin();
+
+    // starts right away when frame 0 is requested, so loading shows up in the trace
+    TraceProfiler::SetThreadName("main");
+    if (opt.traceStartFrame >= 0)
+    {
+        TraceProfiler::Capture(opt.traceStartFrame, opt.traceFrameCount, opt.traceFilename);
+    }
+
     bool isFramebufferSRGBEnabled = opt.vrMode;
 
 #ifndef __ANDROID__
@@ -434,23 +679,76 @@ bool App::Init()
         glDisable(GL_FRAMEBUFFER_SRGB);
     }
 
-    GLenum err = glewInit();
-    if (GLEW_OK != err)
     {
-        Log::E("Error: %s\n", glewGetErrorString(err));
-        return false;
+        StartupReport::Phase phase("gl init");
+        GLenum err = glewInit();
+        if (GLEW_OK != err)
+        {
+            Log::E("Error: %s\n", glewGetErrorString(err));
+            return false;
+        }
     }
 #endif
 
+    // must be set before the first program is loaded
+    if (opt.shaderCache)
+    {
+        Program::SetBinaryCacheDir("shadercache");
+    }
+
+    std::string camerasConfigFilename = FindConfigFile(plyFilename, "cameras.json");
+    // search for vr config file
+    // for example: if plyFilename is "input.ply", then search for "input_vr.json"
+    std::string vrConfigBaseFilename = GetFilenameWithoutExtension(plyFilename) + "_vr.json";
+    std::string vrConfigFilename = FindConfigFile(plyFilename, vrConfigBaseFilename);
+    std::string pointCloudFilename = FindConfigFile(plyFilename, "input.ply");
+
+    // none of the loaders make gl calls, each file is parsed on its own thread while the shaders below
+    // compile, and is only waited for where its gl objects are created.
+    // Programs only wait for their link when first used, errors are reported then.
+    std::future<std::shared_ptr<GaussianCloud>> gaussianCloudFuture =
+        std::async(std::launch::async, LoadGaussianCloud, plyFilename, opt);
+    std::future<std::shared_ptr<PointCloud>> pointCloudFuture;
+    if (!pointCloudFilename.empty())
+    {
+        pointCloudFuture = std::async(std::launch::async, LoadPointCloud, pointCloudFilename, isFramebufferSRGBEnabled);
+    }
+    std::future<std::shared_ptr<CamerasConfig>> camerasConfigFuture;
+    if (!camerasConfigFilename.empty())
+    {
+        camerasConfigFuture = std::async(std::launch::async, LoadCamerasConfig, camerasConfigFilename);
+    }
+    std::future<std::shared_ptr<VrConfig>> vrConfigFuture;
+    if (!vrConfigFilename.empty())
+    {
+        vrConfigFuture = std::async(std::launch::async, LoadVrConfig, vrConfigFilename);
+    }
+    Program::SetDeferredLink(true);
+
+    streamBuffer = std::make_shared<StreamBuffer>(STREAM_BUFFER_REGION_SIZE);
+    if (!streamBuffer->Init())
+    {
+        Log::E("StreamBuffer Init failed\n");
+        return false;
+    }
+
+    // results are only read for the overlay, the benchmark report and traces
+    gpuProfiler = std::make_shared<GpuProfiler>();
+    gpuProfiler->Init();
+    gpuProfiler->SetEnabled(opt.gpuProfile || !opt.benchmarkFilename.empty() || TraceProfiler::IsCapturePending());
+    gpuClockOffsetNs = TraceProfiler::NowNs() - gpuProfiler->GetTimestampNs();
+
+    frameCapture = std::make_shared<FrameCapture>();
+
     debugRenderer = std::make_shared<DebugRenderer>();
-    if (!debugRenderer->Init())
+    if (!debugRenderer->Init(streamBuffer))
     {
         Log::E("DebugRenderer Init failed\n");
         return false;
     }
 
     textRenderer = std::make_shared<TextRenderer>();
-    if (!textRenderer->Init("font/JetBrainsMono-Medium.json", "font/JetBrainsMono-Medium.png"))
+    if (!textRenderer->Init("font/JetBrainsMono-Medium.json", "font/JetBrainsMono-Medium.png", streamBuffer))
     {
         Log::E("TextRenderer Init failed\n");
         return false;
@@ -458,7 +756,8 @@ bool App::Init()
 
     if (opt.vrMode)
     {
-        xrBuddy = std::make_shared<XrBuddy>(mainContext, glm::vec2(Z_NEAR, Z_FAR), sampleCount);
+        StartupReport::Phase phase("openxr init");
+        xrBuddy = std::make_shared<XrBuddy>(mainContext, glm::vec2(Z_NEAR, Z_FAR), sampleCount, opt.sampleMask);
         if (!xrBuddy->Init())
         {
             Log::E("OpenXR Init failed\n");
@@ -466,15 +765,10 @@ bool App::Init()
         }
     }
 
-    std::string camerasConfigFilename = FindConfigFile(plyFilename, "cameras.json");
-    if (!camerasConfigFilename.empty())
+    if (camerasConfigFuture.valid())
     {
-        camerasConfig = std::make_shared<CamerasConfig>();
-        if (!camerasConfig->ImportJson(camerasConfigFilename))
-        {
-            Log::W("Error loading cameras.json\n");
-            camerasConfig.reset();
-        }
+        StartupReport::Phase phase("wait for configs");
+        camerasConfig = camerasConfigFuture.get();
     }
     else
     {
@@ -491,18 +785,10 @@ bool App::Init()
         }
     }
 
-    // search for vr config file
-    // for example: if plyFilename is "input.ply", then search for "input_vr.json"
-    std::string vrConfigBaseFilename = GetFilenameWithoutExtension(plyFilename) + "_vr.json";
-    std::string vrConfigFilename = FindConfigFile(plyFilename, vrConfigBaseFilename);
-    if (!vrConfigFilename.empty())
+    if (vrConfigFuture.valid())
     {
-        vrConfig = std::make_shared<VrConfig>();
-        if (!vrConfig->ImportJson(vrConfigFilename))
-        {
-            Log::I("Could not load vr.json\n");
-            vrConfig.reset();
-        }
+        StartupReport::Phase phase("wait for configs");
+        vrConfig = vrConfigFuture.get();
     }
     else
     {
@@ -561,10 +847,12 @@ bool App::Init()
         return false;
     }
 
-    std::string pointCloudFilename = FindConfigFile(plyFilename, "input.ply");
-    if (!pointCloudFilename.empty())
+    if (pointCloudFuture.valid())
     {
-        pointCloud = LoadPointCloud(pointCloudFilename, isFramebufferSRGBEnabled);
+        {
+            StartupReport::Phase phase("wait for point cloud");
+            pointCloud = pointCloudFuture.get();
+        }
         if (!pointCloud)
         {
             Log::E("Error loading PointCloud\n");
@@ -583,7 +871,11 @@ bool App::Init()
         Log::D("Could not find input.ply\n");
     }
 
-    gaussianCloud = LoadGaussianCloud(plyFilename, opt);
+    {
+        // whatever part of the ply import the work above did not hide
+        StartupReport::Phase phase("wait for ply");
+        gaussianCloud = gaussianCloudFuture.get();
+    }
     if (!gaussianCloud)
     {
         Log::E("Error loading GaussianCloud\n");
@@ -603,13 +895,133 @@ bool App::Init()
 #else
     bool useRgcSortOverride = false;
 #endif
+#if __ANDROID__
+    bool compactTaa = true;
+#else
+    bool compactTaa = opt.compactTaa;
+#endif
+    // the coverage mask is written into the MSAA window or the MSAA xr buffers, both can have fewer
+    // or more samples than were requested
+    int sampleMaskCount = 0;
+    if (opt.sampleMask && sampleCount > 1)
+    {
+        if (opt.vrMode)
+        {
+            sampleMaskCount = xrBuddy->GetSampleCount();
+        }
+        else
+        {
+            GLint windowSamples = 0;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glGetIntegerv(GL_SAMPLES, &windowSamples);
+            sampleMaskCount = (int)windowSamples;
+        }
+        if (sampleMaskCount > 32)
+        {
+            Log::W("--sample-mask supports at most 32 samples, the target has %d\n", sampleMaskCount);
+            sampleMaskCount = 0;
+        }
+        else if (sampleMaskCount != sampleCount)
+        {
+            Log::W("Requested %d samples, the target has %d\n", sampleCount, sampleMaskCount);
+        }
+        if (sampleMaskCount <= 1)
+        {
+            sampleMaskCount = 0;
+        }
+    }
     int eyeCount = opt.vrMode ? 2 : 1;
-    if (!splatRenderer->Init(gaussianCloud, isFramebufferSRGBEnabled, useRgcSortOverride, GetRenderMode(), eyeCount, customWidth, customHeight, opt.taa))
     {
-        Log::E("Error initializing splat renderer!\n");
+        StartupReport::Phase phase("renderer init");
+        if (!splatRenderer->Init(gaussianCloud, isFramebufferSRGBEnabled, useRgcSortOverride, GetRenderMode(), eyeCount, customWidth, customHeight, opt.taa, compactTaa, opt.adaptiveSamples, sampleMaskCount, opt.hiz, opt.splatBudget))
+        {
+            Log::E("Error initializing splat renderer!\n");
+            return false;
+        }
+    }
+
+    // every startup program is submitted, the ones loaded from here on, e.g. by the overdraw
+    // heatmap or when switching render modes, report errors right away
+    Program::SetDeferredLink(false);
+    {
+        // a shader that does not build still fails the init
+        StartupReport::Phase phase("wait for shaders");
+        if (!Program::FinishPendingLinks())
+        {
+            Log::E("Error building startup shaders\n");
+            return false;
+        }
+    }
+
+    // also kept in AB, it is used once the mode is switched
+    splatRenderer->SetNoiseType((splat::SplatRenderer::NoiseType)opt.noiseType);
+    splatRenderer->SetHybridNearDepth(opt.hybridNearDepth);
+    splatRenderer->SetGpuProfiler(gpuProfiler);
+    if (opt.overdrawHeatmap && !splatRenderer->SetOverdrawHeatmap(true))
+    {
+        opt.overdrawHeatmap = false;
+    }
+    // the splats live in the vertex buffer now, switching to a sorted mode later reads them back
+    if (!opt.keepCpuData)
+    {
+        gaussianCloud->ReleaseData(splatRenderer->GetGpuDataFetcher());
+    }
+
+    if (!opt.replayFilename.empty())
+    {
+        replay = std::make_shared<CameraRecording>();
+        if (!replay->ImportFile(opt.replayFilename) || replay->GetNumFrames() == 0)
+        {
+            Log::E("Error loading camera recording \"%s\"\n", opt.replayFilename.c_str());
+            return false;
+        }
+        replayFrame = 0;
+    }
+
+    if (!opt.recordFilename.empty())
+    {
+        recording = std::make_shared<CameraRecording>();
+        if (!recording->OpenForWrite(opt.recordFilename))
+        {
+            return false;
+        }
+    }
+
+    if (opt.capture && !StartFrameCapture())
+    {
         return false;
     }
 
+    if (!opt.benchmarkFilename.empty())
+    {
+        Benchmark::Options benchmarkOptions;
+        benchmarkOptions.warmupFrames = opt.benchmarkWarmupFrames;
+        benchmarkOptions.framesPerCamera = opt.benchmarkFramesPerCamera;
+        if (replay)
+        {
+            // times the recorded frames instead of the cameras
+            std::vector<glm::mat4> path;
+            for (size_t i = 0; i < replay->GetNumFrames(); i++)
+            {
+                path.push_back(replay->GetFrame(i).views[0].cameraMat);
+            }
+            benchmark = std::make_shared<Benchmark>(path, benchmarkOptions);
+        }
+        else
+        {
+            if (!camerasConfig || camerasConfig->GetNumCameras() == 0)
+            {
+                Log::E("--benchmark flies through the cameras of cameras.json, none were found\n");
+                return false;
+            }
+            benchmark = std::make_shared<Benchmark>(camerasConfig->GetCameraVec(), benchmarkOptions);
+        }
+
+        // the stochastic modes draw the same random sequence on every run
+        srand(BENCHMARK_SEED);
+        lastFrameTime = std::chrono::steady_clock::now();
+    }
+
     if (opt.vrMode)
     {
         desktopProgram = std::make_shared<Program>();
@@ -628,6 +1040,10 @@ bool App::Init()
             Clear(glm::ivec2(0, 0), false);
 
             glm::mat4 fullEyeMat = magicCarpet->GetCarpetMat() * eyeMat;
+            if (recording)
+            {
+                recording->AddView({fullEyeMat, projMat, viewport, nearFar});
+            }
 
             if (opt.drawDebug)
             {
@@ -733,6 +1149,31 @@ bool App::Init()
         }
     });
 
+    inputBuddy->OnKey(SDLK_b, [this](bool down, uint16_t mod)
+    {
+        if (down && GetRenderMode() != "AB")
+        {
+            using NoiseType = splat::SplatRenderer::NoiseType;
+            int next = ((int)splatRenderer->GetNoiseType() + 1) % (int)NoiseType::Count;
+            splatRenderer->SetNoiseType((NoiseType)next);
+            Log::I("noise type %d\n", next);
+        }
+    });
+
+    inputBuddy->OnKey(SDLK_m, [this](bool down, uint16_t mod)
+    {
+        if (down)
+        {
+            auto iter = std::find(RENDER_MODES.begin(), RENDER_MODES.end(), opt.renderMode);
+            size_t next = (iter - RENDER_MODES.begin() + 1) % RENDER_MODES.size();
+            // keeps the current mode if the next one fails to build
+            if (splatRenderer->SetRenderMode(RENDER_MODES[next]))
+            {
+                opt.renderMode = RENDER_MODES[next];
+            }
+        }
+    });
+
     inputBuddy->OnKey(SDLK_f, [this](bool down, uint16_t mod)
     {
         if (down)
@@ -799,6 +1240,61 @@ bool App::Init()
         }
     });
 
+    inputBuddy->OnKey(SDLK_F2, [this](bool down, uint16_t mod)
+    {
+        if (down)
+        {
+            opt.gpuProfile = !opt.gpuProfile;
+            gpuProfiler->SetEnabled(opt.gpuProfile || benchmark || TraceProfiler::IsCapturePending());
+            textRenderer->SetText(gpuProfileText, "");
+        }
+    });
+
+    inputBuddy->OnKey(SDLK_F4, [this](bool down, uint16_t mod)
+    {
+        if (down && splatRenderer->SetOverdrawHeatmap(!opt.overdrawHeatmap))
+        {
+            opt.overdrawHeatmap = !opt.overdrawHeatmap;
+            textRenderer->SetText(gpuProfileText, "");
+            forceRedraw = true;
+        }
+    });
+
+    inputBuddy->OnKey(SDLK_F3, [this](bool down, uint16_t mod)
+    {
+        if (down && !TraceProfiler::IsCapturePending())
+        {
+            Log::I("Recording %d frames to \"%s\"\n", opt.traceFrameCount, opt.traceFilename.c_str());
+            TraceProfiler::Capture(TraceProfiler::GetFrame(), opt.traceFrameCount, opt.traceFilename);
+            gpuProfiler->SetEnabled(true);
+            gpuClockOffsetNs = TraceProfiler::NowNs() - gpuProfiler->GetTimestampNs();
+        }
+    });
+
+    inputBuddy->OnKey(SDLK_F5, [this](bool down, uint16_t mod)
+    {
+        if (down)
+        {
+            if (frameCapture->IsCapturing())
+            {
+                frameCapture->Stop();
+            }
+            else
+            {
+                StartFrameCapture();
+            }
+        }
+    });
+
+    inputBuddy->OnKey(SDLK_F6, [this](bool down, uint16_t mod)
+    {
+        if (down)
+        {
+            opt.memoryOverlay = !opt.memoryOverlay;
+            textRenderer->SetText(gpuProfileText, "");
+        }
+    });
+
     inputBuddy->OnKey(SDLK_a, [this](bool down, uint16_t mod)
     {
         virtualLeftStick.x += down ? -1.0f : 1.0f;
@@ -883,6 +1379,7 @@ bool App::Init()
 #endif // USE_SDL
 
     fpsText = textRenderer->AddScreenTextWithDropShadow(glm::ivec2(0, 0), (int)TEXT_NUM_ROWS, WHITE, BLACK, "fps:");
+    gpuProfileText = textRenderer->AddScreenTextWithDropShadow(glm::ivec2(0, 1), (int)TEXT_NUM_ROWS, WHITE, BLACK, "");
 
     return true;
 }
@@ -892,13 +1389,14 @@ void App::ProcessEvent(const SDL_Event& event)
 #ifdef USE_SDL
     inputBuddy->ProcessEvent(event);
 #endif
+    // any input or window event may change what is on screen
+    forceRedraw = true;
 }
 
 void App::UpdateFps(float fps)
 {
     std::string text = "fps: " + std::to_string((int)fps);
-    textRenderer->RemoveText(fpsText);
-    fpsText = textRenderer->AddScreenTextWithDropShadow(glm::ivec2(0, 0), TEXT_NUM_ROWS, WHITE, BLACK, text);
+    textRenderer->SetText(fpsText, text);
 
 //#define FIND_BEST_NUM_BLOCKS_PER_WORKGROUP
 #ifdef FIND_BEST_NUM_BLOCKS_PER_WORKGROUP
@@ -1022,10 +1520,81 @@ bool App::Process(float dt)
     return true;
 }
 
+bool App::IsIdle(const glm::ivec2& windowSize) const
+{
+    // vr compositors expect a new frame every display refresh
+    if (!opt.idle || opt.vrMode || forceRedraw)
+    {
+        return false;
+    }
+
+    if (windowSize != lastRenderSize || flyCam->GetCameraMat() != lastRenderCameraMat)
+    {
+        return false;
+    }
+
+    // the point cloud is deterministic, the splats may still be accumulating TAA samples
+    return opt.drawPointCloud || splatRenderer->IsConverged();
+}
+
 bool App::Render(float dt, const glm::ivec2& windowSize)
 {
     int width = windowSize.x;
     int height = windowSize.y;
+    double sortMs = 0.0;
+    double renderMs = 0.0;
+
+    gpuProfiler->BeginFrame();
+    if ((opt.gpuProfile && gpuProfiler->GetResultsFrame() != lastGpuResultsFrame) || opt.overdrawHeatmap ||
+        opt.memoryOverlay)
+    {
+        std::string text = opt.gpuProfile ? gpuProfiler->FormatResults() : "";
+        if (opt.overdrawHeatmap)
+        {
+            // waits for last frame's heatmap, it slows rendering down anyway
+            splat::SplatRenderer::OverdrawStats overdraw = splatRenderer->ReadOverdrawStats();
+            char line[128];
+            snprintf(line, sizeof(line), "overdraw: mean %.1f, p50 %u, p95 %u, max %u%s\n", overdraw.mean,
+                     overdraw.p50, overdraw.p95, overdraw.max, overdraw.max >= 256 ? "+" : "");
+            text += line;
+        }
+        if (opt.memoryOverlay)
+        {
+            text += MemoryTracker::FormatReport();
+        }
+        textRenderer->SetText(gpuProfileText, text);
+    }
+    if (TraceProfiler::IsCapturePending() && gpuProfiler->GetResultsFrame() != lastGpuResultsFrame)
+    {
+        for (auto&& result : gpuProfiler->GetResults())
+        {
+            TraceProfiler::AddGpuZone(result.name, result.beginNs + gpuClockOffsetNs, result.endNs + gpuClockOffsetNs);
+        }
+    }
+
+    // a replayed frame is rendered with the render mode and random sequence it was recorded with
+    const CameraRecording::Frame* replayed = nullptr;
+    if (replay)
+    {
+        replayed = &replay->GetFrame(benchmark ? (size_t)benchmark->GetPathFrame() :
+                                     std::min(replayFrame, replay->GetNumFrames() - 1));
+        if (replayed->renderMode != GetRenderMode() && splatRenderer->SetRenderMode(replayed->renderMode))
+        {
+            opt.renderMode = replayed->renderMode;
+        }
+        if (frameNum == 0 && replayed->windowSize != windowSize)
+        {
+            Log::W("Replaying a %dx%d recording in a %dx%d window\n", replayed->windowSize.x, replayed->windowSize.y,
+                   width, height);
+        }
+        srand(replayed->seed);
+    }
+    else if (recording)
+    {
+        uint32_t seed = RECORD_SEED + frameNum;
+        srand(seed);
+        recording->BeginFrame(dt, windowSize, GetRenderMode(), seed);
+    }
 
     if (opt.vrMode)
     {
@@ -1043,6 +1612,7 @@ bool App::Render(float dt, const glm::ivec2& windowSize)
         }
 #ifndef __ANDROID__
         // render desktop.
+        GpuProfiler::Zone gpuZone(gpuProfiler.get(), "display");
         Clear(windowSize, true);
         RenderDesktop(windowSize, desktopProgram, xrBuddy->GetColorTexture(), true);
 
@@ -1057,6 +1627,14 @@ bool App::Render(float dt, const glm::ivec2& windowSize)
     }
     else
     {
+        if (opt.convergenceFrames > 0)
+        {
+            RunConvergenceTest(windowSize);
+            opt.convergenceFrames = 0;
+            quitCallback();
+            return true;
+        }
+
         // lazy init of fbo, fbo is only used for HalfFloat, Float option.
         if (opt.frameBuffer != Options::FrameBuffer::Default && fboSize != windowSize)
         {
@@ -1096,10 +1674,25 @@ bool App::Render(float dt, const glm::ivec2& windowSize)
 
         Clear(windowSize, true);
 
-        glm::mat4 cameraMat = flyCam->GetCameraMat();
+        glm::mat4 cameraMat = benchmark ? benchmark->GetCameraMat() : flyCam->GetCameraMat();
         glm::vec4 viewport(0.0f, 0.0f, (float)width, (float)height);
         glm::vec2 nearFar(Z_NEAR, Z_FAR);
         glm::mat4 projMat = glm::perspective(FOVY, (float)width / (float)height, Z_NEAR, Z_FAR);
+        if (replayed)
+        {
+            // the first eye of a vr recording
+            cameraMat = replayed->views[0].cameraMat;
+            projMat = replayed->views[0].projMat;
+            nearFar = replayed->views[0].nearFar;
+        }
+        else if (recording)
+        {
+            recording->AddView({cameraMat, projMat, viewport, nearFar});
+        }
+
+        lastRenderCameraMat = cameraMat;
+        lastRenderSize = windowSize;
+        forceRedraw = false;
 
         if (opt.drawDebug)
         {
@@ -1124,10 +1717,16 @@ bool App::Render(float dt, const glm::ivec2& windowSize)
         }
         else
         {
+            auto sortStart = std::chrono::steady_clock::now();
             splatRenderer->Sort(cameraMat, projMat, nearFar);
+            auto renderStart = std::chrono::steady_clock::now();
             splatRenderer->Render(cameraMat, projMat, viewport, nearFar);
+            auto renderEnd = std::chrono::steady_clock::now();
+            sortMs = std::chrono::duration<double, std::milli>(renderStart - sortStart).count();
+            renderMs = std::chrono::duration<double, std::milli>(renderEnd - renderStart).count();
         }
 
+        GpuProfiler::Zone gpuZone(gpuProfiler.get(), "display");
         if (opt.drawFps)
         {
             textRenderer->Render(cameraMat, projMat, viewport, nearFar);
@@ -1142,13 +1741,256 @@ bool App::Render(float dt, const glm::ivec2& windowSize)
         }
     }
 
+    if (frameCapture->IsCapturing())
+    {
+        // the eye texture of the last xr frame, or the window as it is about to be presented
+        GpuProfiler::Zone gpuZone(gpuProfiler.get(), "capture");
+        if (opt.vrMode)
+        {
+            glm::ivec2 size = xrBuddy->GetColorTextureSize();
+            frameCapture->CaptureTexture(xrBuddy->GetColorTexture(), size.x, size.y);
+        }
+        else
+        {
+            frameCapture->CaptureFramebuffer(0, width, height);
+        }
+    }
+
     debugRenderer->EndFrame();
+    streamBuffer->EndFrame();
+    gpuProfiler->EndFrame();
+
+    if (recording && !recording->EndFrame())
+    {
+        Log::E("Error writing camera recording, recording stopped\n");
+        recording.reset();
+    }
+
+    // with --benchmark the replay follows the benchmark's frames, warmup included
+    if (replay && !benchmark && ++replayFrame == replay->GetNumFrames())
+    {
+        std::cout << "replayed " << replayFrame << " frames of \"" << opt.replayFilename << "\"" << std::endl;
+        quitCallback();
+    }
+
+    if (benchmark)
+    {
+        UpdateBenchmark(sortMs, renderMs);
+    }
+    lastGpuResultsFrame = gpuProfiler->GetResultsFrame();
+
+    // the gpu zones are only needed for the overlay and the benchmark once the trace is written
+    bool tracing = TraceProfiler::IsCapturePending();
+    TraceProfiler::EndFrame();
+    if (tracing && !TraceProfiler::IsCapturePending())
+    {
+        gpuProfiler->SetEnabled(opt.gpuProfile || benchmark);
+    }
+
+    // in vr the splats are first drawn once the session is ready
+    if (StartupReport::IsRecording() && (!opt.vrMode || xrBuddy->SessionReady()))
+    {
+        StartupReport::End();
+        if (opt.startupReport)
+        {
+            std::cout << StartupReport::FormatReport() << std::flush;
+        }
+        else
+        {
+            Log::D("%s", StartupReport::FormatReport().c_str());
+        }
+    }
 
     frameNum++;
 
     return true;
 }
 
+void App::RunConvergenceTest(const glm::ivec2& windowSize)
+{
+    ZoneScoped;
+
+    if (GetRenderMode() == "AB" || !opt.taa)
+    {
+        Log::E("--convergence-test needs a stochastic render mode with TAA\n");
+        return;
+    }
+
+    const int width = windowSize.x;
+    const int height = windowSize.y;
+    const uint32_t SEED = 1234;
+
+    glm::mat4 cameraMat = flyCam->GetCameraMat();
+    glm::vec4 viewport(0.0f, 0.0f, (float)width, (float)height);
+    glm::vec2 nearFar(Z_NEAR, Z_FAR);
+    glm::mat4 projMat = glm::perspective(FOVY, (float)width / (float)height, Z_NEAR, Z_FAR);
+
+    // float target, so the error is not dominated by 8 bit quantization
+    Texture::Params texParams;
+    texParams.minFilter = FilterType::Nearest;
+    texParams.magFilter = FilterType::Nearest;
+    texParams.sWrap = WrapType::ClampToEdge;
+    texParams.tWrap = WrapType::ClampToEdge;
+    auto target = std::make_shared<FrameBuffer>();
+    target->AttachColor(std::make_shared<Texture>(width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, texParams));
+    target->AttachDepth(std::make_shared<Texture>(width, height, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, texParams));
+    if (!target->IsComplete())
+    {
+        Log::E("convergence test framebuffer is not complete\n");
+        return;
+    }
+
+    auto readPixels = [width, height]()
+    {
+        std::vector<float> pixels((size_t)width * height * 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, pixels.data());
+        return pixels;
+    };
+
+    // sorted alpha blending reference
+    std::vector<float> reference;
+    {
+        auto abRenderer = std::make_shared<splat::SplatRenderer>();
+        if (!abRenderer->Init(gaussianCloud, false, false, "AB", 1, width, height, false, false, 0, 0, false, 0))
+        {
+            Log::E("Error initializing reference splat renderer!\n");
+            return;
+        }
+        target->Bind();
+        Clear(windowSize, true);
+        abRenderer->Sort(cameraMat, projMat, nearFar);
+        abRenderer->Render(cameraMat, projMat, viewport, nearFar);
+        reference = readPixels();
+    }
+
+    const char* noiseNames[] = {"white", "blue", "sobol"};
+    using NoiseType = splat::SplatRenderer::NoiseType;
+    NoiseType prevNoiseType = splatRenderer->GetNoiseType();
+    splatRenderer->SetPresentFbo(target->fbo);
+    splatRenderer->resetTemporalTextures(width, height);
+
+    // with motion the camera slides into the start view over the first half of the frames, so the
+    // reprojection of the history is part of what is measured
+    const int motionFrames = opt.convergenceMotion ? opt.convergenceFrames / 2 : 0;
+    const float MOTION_DISTANCE = 0.25f;
+    auto frameCameraMat = [&cameraMat, motionFrames, MOTION_DISTANCE](int frame)
+    {
+        if (frame >= motionFrames)
+        {
+            return cameraMat;
+        }
+        float t = 1.0f - (float)frame / (float)motionFrames;
+        return glm::translate(cameraMat, glm::vec3(-MOTION_DISTANCE * t, 0.0f, 0.0f));
+    };
+
+    std::cout << "convergence test, " << opt.renderMode << ", " << width << "x" << height
+              << (motionFrames > 0 ? ", moving camera" : "") << std::endl;
+    for (int type = 0; type < (int)NoiseType::Count; type++)
+    {
+        splatRenderer->SetNoiseType((NoiseType)type);
+        srand(SEED);
+        for (int frame = 1; frame <= opt.convergenceFrames; frame++)
+        {
+            target->Bind();
+            Clear(windowSize, true);
+            glm::mat4 frameMat = frameCameraMat(frame);
+            splatRenderer->Sort(frameMat, projMat, nearFar);
+            splatRenderer->Render(frameMat, projMat, viewport, nearFar);
+
+            // report at powers of two and at the last frame
+            if ((frame & (frame - 1)) == 0 || frame == opt.convergenceFrames)
+            {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, target->fbo);
+                std::vector<float> pixels = readPixels();
+                double sum = 0.0;
+                for (size_t i = 0; i < pixels.size(); i += 4)
+                {
+                    for (size_t c = 0; c < 3; c++)
+                    {
+                        double d = (double)pixels[i + c] - (double)reference[i + c];
+                        sum += d * d;
+                    }
+                }
+                double mse = sum / ((double)width * height * 3.0);
+                double psnr = mse > 0.0 ? 10.0 * log10(1.0 / mse) : std::numeric_limits<double>::infinity();
+                std::cout << "    noise = " << noiseNames[type] << ", frames = " << frame
+                          << ", rmse = " << sqrt(mse) << ", psnr = " << psnr << " dB" << std::endl;
+            }
+        }
+    }
+
+    splatRenderer->SetPresentFbo(0);
+    splatRenderer->SetNoiseType(prevNoiseType);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GL_ERROR_CHECK("App::RunConvergenceTest()");
+}
+
+void App::UpdateBenchmark(double sortMs, double renderMs)
+{
+    // the time between the ends of two frames, the previous present included
+    auto now = std::chrono::steady_clock::now();
+    splat::SplatRenderer::FrameStats stats = splatRenderer->ReadFrameStats();
+    Benchmark::Sample sample;
+    sample.frameMs = std::chrono::duration<double, std::milli>(now - lastFrameTime).count();
+    sample.sortMs = sortMs;
+    sample.renderMs = renderMs;
+    sample.drawCount = stats.drawCount;
+    sample.sortCount = stats.sortCount;
+    if (gpuProfiler->GetResultsFrame() != lastGpuResultsFrame)
+    {
+        benchmark->AddGpuResults(gpuProfiler->GetResults());
+        if (gpuProfiler->HasPipelineStats())
+        {
+            benchmark->AddPipelineStats(gpuProfiler->GetPipelineStats());
+        }
+    }
+    benchmark->AddSample(sample);
+    lastFrameTime = std::chrono::steady_clock::now();
+
+    if (benchmark->IsDone())
+    {
+        Benchmark::Info info;
+        info.plyFilename = plyFilename;
+        info.renderMode = splatRenderer->GetRenderMode();
+        info.glRenderer = (const char*)glGetString(GL_RENDERER);
+        info.glVersion = (const char*)glGetString(GL_VERSION);
+        info.width = lastRenderSize.x;
+        info.height = lastRenderSize.y;
+        info.splatCount = (uint32_t)gaussianCloud->GetNumGaussians();
+        benchmark->PrintSummary();
+        if (!benchmark->WriteReport(opt.benchmarkFilename, info))
+        {
+            Log::E("Error writing benchmark report\n");
+        }
+        benchmark.reset();
+        quitCallback();
+    }
+}
+
+bool App::StartFrameCapture()
+{
+    bool started = opt.capturePipe.empty() ? frameCapture->StartPngSequence(opt.captureFilename) :
+        frameCapture->StartPipe(opt.capturePipe);
+    if (started)
+    {
+        Log::I("Capturing frames to \"%s\"\n", opt.capturePipe.empty() ? opt.captureFilename.c_str() : opt.capturePipe.c_str());
+    }
+    return started;
+}
+
+void App::Shutdown()
+{
+    // the last frames are still being read back and written
+    if (frameCapture)
+    {
+        frameCapture->Stop();
+    }
+    if (recording)
+    {
+        recording->Close();
+    }
+}
+
 void App::OnQuit(const VoidCallback& cb)
 {
     quitCallback = cb;
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <glm/glm.hpp>
 #include <memory>
@@ -14,10 +15,14 @@
 
 #include "maincontext.h"
 
+class Benchmark;
+class CameraRecording;
 class CamerasConfig;
 class CameraPathRenderer;
 class DebugRenderer;
 class FlyCam;
+class FrameCapture;
+class GpuProfiler;
 struct FrameBuffer;
 class GaussianCloud;
 class InputBuddy;
@@ -26,6 +31,7 @@ class PointCloud;
 class PointRenderer;
 class Program;
 namespace splat {class SplatRenderer;}
+class StreamBuffer;
 class TextRenderer;
 struct Texture;
 class VrConfig;
@@ -52,6 +58,10 @@ public:
     void ProcessEvent(const SDL_Event& event);
     bool Process(float dt);
     bool Render(float dt, const glm::ivec2& windowSize);
+    // finishes the work that outlives a frame, call while the gl context is still current
+    void Shutdown();
+    // true when the last frame on screen is still correct and need not be rendered again
+    bool IsIdle(const glm::ivec2& windowSize) const;
     int GetSampleCount() const { return sampleCount; }
     void SetSampleCount(int count) { sampleCount = count; }
     int GetCustomWidth() const { return customWidth; }
@@ -87,17 +97,60 @@ public:
         bool importFullSH = true;
         std::string renderMode = "ST";
         bool taa = true;
+        bool compactTaa = false;
+        bool idle = false;
+        int adaptiveSamples = 0;
+        bool sampleMask = false;
+        int noiseType = 0;  // splat::SplatRenderer::NoiseType
+        int convergenceFrames = 0;
+        bool convergenceMotion = false;  // the convergence test slides into the start view
+        float hybridNearDepth = 2.0f;
+        bool hiz = false;
+        uint32_t splatBudget = 0;
+        bool shaderCache = true;
+        std::string benchmarkFilename;  // empty unless --benchmark
+        int benchmarkWarmupFrames = 60;
+        int benchmarkFramesPerCamera = 30;
+        bool gpuProfile = false;  // gpu time per stage in the overlay
+        bool overdrawHeatmap = false;
+        std::string traceFilename = "trace.json";  // also written by F3
+        int traceStartFrame = -1;  // -1 unless --trace or --trace-start
+        int traceFrameCount = 120;
+        std::string recordFilename;  // empty unless --record
+        std::string replayFilename;  // empty unless --replay
+        bool capture = false;
+        std::string captureFilename = "capture/frame_%05d.png";  // also written by F5
+        std::string capturePipe;  // encoder command, replaces the png sequence
+        bool startupReport = false;  // printed once the first frame is rendered
+        bool memoryOverlay = false;  // memory per subsystem in the overlay, toggled by F6
+        bool keepCpuData = false;  // otherwise the cpu copy of the splats is freed once uploaded
     };
 
 protected:
+    // render the current view with each noise type and print the error against an AB reference
+    void RunConvergenceTest(const glm::ivec2& windowSize);
+    // records the frame just rendered, writes the report and quits after the last one
+    void UpdateBenchmark(double sortMs, double renderMs);
+    bool StartFrameCapture();
+
     MainContext& mainContext;
     Options opt;
     std::string plyFilename;
+    std::shared_ptr<StreamBuffer> streamBuffer;
+    std::shared_ptr<GpuProfiler> gpuProfiler;
+    std::shared_ptr<FrameCapture> frameCapture;
     std::shared_ptr<DebugRenderer> debugRenderer;
     std::shared_ptr<CameraPathRenderer> cameraPathRenderer;
     std::shared_ptr<TextRenderer> textRenderer;
     std::shared_ptr<XrBuddy> xrBuddy;
 
+    std::shared_ptr<Benchmark> benchmark;
+    std::chrono::steady_clock::time_point lastFrameTime;
+
+    std::shared_ptr<CameraRecording> recording;
+    std::shared_ptr<CameraRecording> replay;
+    size_t replayFrame = 0;
+
     std::shared_ptr<CamerasConfig> camerasConfig;
     std::shared_ptr<VrConfig> vrConfig;
 
@@ -124,8 +177,16 @@ protected:
     float virtualRoll;
     float virtualUp;
     uint32_t fpsText;
+    uint32_t gpuProfileText;
+    uint64_t lastGpuResultsFrame = 0;
+    int64_t gpuClockOffsetNs = 0;  // added to gpu timestamps to get TraceProfiler::NowNs() times
     uint32_t frameNum;
 
+    // state of the last desktop frame, used for idle detection
+    glm::mat4 lastRenderCameraMat = glm::mat4(0.0f);
+    glm::ivec2 lastRenderSize = {0, 0};
+    bool forceRedraw = true;
+
     VoidCallback quitCallback;
     ResizeCallback resizeCallback;
 
@@ -0,0 +1,624 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+// headless batch renderer, renders every camera in cameras.json to an image file, or replays a camera
+// recording made with the viewer's --record and writes the time of every frame.
+// Uses an EGL context without a window, so it also runs with Mesa llvmpipe on machines without a gpu.
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "core/framebuffer.h"
+#include "core/image.h"
+#include "core/log.h"
+#include "core/texture.h"
+#include "core/util.h"
+
+#include "camerarecording.h"
+#include "camerasconfig.h"
+#include "gaussiancloud.h"
+#include "splatrenderer.h"
+
+const float Z_NEAR = 0.1f;
+const float Z_FAR = 1000.0f;
+const uint32_t SEED = 1234;
+
+struct BatchOptions
+{
+    std::string plyFilename;
+    std::string camerasFilename;
+    std::string replayFilename;
+    bool replayImages = false;
+    std::string outDir = "batch_out";
+    std::string renderMode = "ST";
+    std::string format = "png";
+    int width = 1280;
+    int height = 720;
+    int taaFrames = 16;
+    bool importFullSH = true;
+    bool debugLogging = false;
+};
+
+struct EGLState
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+};
+
+static void PrintUsage()
+{
+    fprintf(stdout, "\
+USAGE: splatapult_batch [options] <input.ply>\n\
+\n\
+Options\n\
+--------------------\n\
+  --cameras FILE       cameras.json to render, searched for next to the ply by default\n\
+  --replay FILE        replay a camera recording instead, writes replay.csv with the time of every frame\n\
+  --replay-images      also write an image of every replayed frame\n\
+  --out DIR            output directory (default batch_out)\n\
+  --width N            image width (default 1280), a replay uses the recorded size\n\
+  --height N           image height (default 720)\n\
+  --render_mode MODE   AB, ST, ST-popfree or hybrid (default ST), a replay uses the recorded modes\n\
+  --taa-frames N       frames accumulated per view by the stochastic modes (default 16)\n\
+  --format FMT         png or exr (default png)\n\
+  --nosh               don't load/render full sh, will reduce memory usage and higher performance\n\
+  -d, --debug          enable verbose debug logging\n\
+  -h, --help           print this message\n\
+\n");
+}
+
+// same search as the viewer, current, parent and grandparent directories of the ply
+static std::string FindCamerasFile(const std::string& plyFilename)
+{
+    std::filesystem::path directory = std::filesystem::path(plyFilename).parent_path();
+    for (int i = 0; i < 3; ++i)
+    {
+        std::filesystem::path configPath = directory / "cameras.json";
+        if (std::filesystem::exists(configPath) && std::filesystem::is_regular_file(configPath))
+        {
+            return configPath.string();
+        }
+        if (!directory.has_parent_path())
+        {
+            break;
+        }
+        directory = directory.parent_path();
+    }
+    return "";
+}
+
+static bool ParseArguments(int argc, const char* argv[], BatchOptions& opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0))
+        {
+            PrintUsage();
+            exit(EXIT_SUCCESS);
+        }
+        if (strcmp(argv[i], "--cameras") == 0 && i + 1 < argc)
+        {
+            opt.camerasFilename = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            opt.replayFilename = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--replay-images") == 0)
+        {
+            opt.replayImages = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            opt.outDir = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+        {
+            opt.width = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--height") == 0 && i + 1 < argc)
+        {
+            opt.height = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--render_mode") == 0 && i + 1 < argc)
+        {
+            opt.renderMode = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--taa-frames") == 0 && i + 1 < argc)
+        {
+            opt.taaFrames = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            opt.format = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--nosh") == 0)
+        {
+            opt.importFullSH = false;
+            continue;
+        }
+        if (strcmp(argv[i], "--debug") == 0 || strcmp(argv[i], "-d") == 0)
+        {
+            opt.debugLogging = true;
+            continue;
+        }
+        if (argv[i][0] == '-')
+        {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return false;
+        }
+        opt.plyFilename = argv[i];
+    }
+
+    if (opt.plyFilename.empty())
+    {
+        PrintUsage();
+        return false;
+    }
+    if (opt.width <= 0 || opt.height <= 0 || opt.taaFrames <= 0)
+    {
+        std::cerr << "Error: --width, --height and --taa-frames must be positive" << std::endl;
+        return false;
+    }
+    if (opt.format != "png" && opt.format != "exr")
+    {
+        std::cerr << "Error: Invalid value for --format: " << opt.format << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool InitEGL(EGLState& egl)
+{
+    // older llvmpipe only reports 4.5 but covers what the renderer needs, drivers other than Mesa ignore these.
+    // Values set by the user take precedence.
+    setenv("MESA_GL_VERSION_OVERRIDE", "4.6", 0);
+    setenv("MESA_GLSL_VERSION_OVERRIDE", "460", 0);
+
+    // prefer the surfaceless platform, it needs neither an X server nor a gpu
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+    {
+        egl.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (egl.display == EGL_NO_DISPLAY)
+    {
+        egl.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major, minor;
+    if (egl.display == EGL_NO_DISPLAY || !eglInitialize(egl.display, &major, &minor))
+    {
+        Log::E("Failed to initialize EGL display, error = 0x%x\n", eglGetError());
+        return false;
+    }
+    Log::D("EGL version %d.%d, vendor = %s\n", major, minor, eglQueryString(egl.display, EGL_VENDOR));
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        Log::E("EGL does not support desktop OpenGL\n");
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(egl.display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0)
+    {
+        Log::E("No suitable EGL config found\n");
+        return false;
+    }
+
+    // the shaders are #version 460
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 6,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    egl.context = eglCreateContext(egl.display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (egl.context == EGL_NO_CONTEXT)
+    {
+        Log::E("Failed to create an OpenGL 4.6 context, error = 0x%x\n", eglGetError());
+        return false;
+    }
+
+    // everything is drawn into framebuffer objects, a surface is only needed without EGL_KHR_surfaceless_context
+    const char* extensions = eglQueryString(egl.display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        egl.surface = eglCreatePbufferSurface(egl.display, config, pbufferAttribs);
+        if (egl.surface == EGL_NO_SURFACE)
+        {
+            Log::E("Failed to create EGL pbuffer surface, error = 0x%x\n", eglGetError());
+            return false;
+        }
+    }
+
+    if (!eglMakeCurrent(egl.display, egl.surface, egl.surface, egl.context))
+    {
+        Log::E("eglMakeCurrent failed, error = 0x%x\n", eglGetError());
+        return false;
+    }
+    return true;
+}
+
+static void ShutdownEGL(EGLState& egl)
+{
+    if (egl.display == EGL_NO_DISPLAY)
+    {
+        return;
+    }
+    eglMakeCurrent(egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (egl.surface != EGL_NO_SURFACE)
+    {
+        eglDestroySurface(egl.display, egl.surface);
+    }
+    if (egl.context != EGL_NO_CONTEXT)
+    {
+        eglDestroyContext(egl.display, egl.context);
+    }
+    eglTerminate(egl.display);
+}
+
+static bool SaveView(const BatchOptions& opt, const std::string& filename, const std::vector<float>& pixels)
+{
+    if (opt.format == "exr")
+    {
+        return SaveEXR(filename, opt.width, opt.height, pixels);
+    }
+
+    // the splat shaders already write display encoded colors, they are only quantized
+    Image image;
+    image.width = opt.width;
+    image.height = opt.height;
+    image.pixelFormat = PixelFormat::RGBA;
+    image.isSRGB = true;
+    image.data.resize(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        image.data[i] = (uint8_t)(glm::clamp(pixels[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    return image.Save(filename);
+}
+
+static std::shared_ptr<GaussianCloud> LoadGaussianCloud(const BatchOptions& opt)
+{
+    GaussianCloud::Options cloudOptions = {0};
+    cloudOptions.importFullSH = opt.importFullSH;
+    cloudOptions.exportFullSH = true;
+    auto gaussianCloud = std::make_shared<GaussianCloud>(cloudOptions);
+    if (!gaussianCloud->ImportPly(opt.plyFilename))
+    {
+        Log::E("Error loading GaussianCloud!\n");
+        return nullptr;
+    }
+    return gaussianCloud;
+}
+
+// float color target the splats are rendered into and read back from
+static std::shared_ptr<FrameBuffer> CreateTarget(int width, int height)
+{
+    Texture::Params texParams;
+    texParams.minFilter = FilterType::Nearest;
+    texParams.magFilter = FilterType::Nearest;
+    texParams.sWrap = WrapType::ClampToEdge;
+    texParams.tWrap = WrapType::ClampToEdge;
+    auto target = std::make_shared<FrameBuffer>();
+    target->AttachColor(std::make_shared<Texture>(width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, texParams));
+    target->AttachDepth(std::make_shared<Texture>(width, height, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, texParams));
+    if (!target->IsComplete())
+    {
+        Log::E("batch framebuffer is not complete\n");
+        return nullptr;
+    }
+    return target;
+}
+
+static bool CreateOutDir(const BatchOptions& opt)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(opt.outDir, ec);
+    if (ec)
+    {
+        Log::E("Could not create output directory \"%s\"\n", opt.outDir.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void ClearTarget(const std::shared_ptr<FrameBuffer>& target, int width, int height)
+{
+    target->Bind();
+    glViewport(0, 0, width, height);
+
+    // pre-multiplied alpha blending
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+}
+
+static bool RenderViews(const BatchOptions& opt)
+{
+    auto gaussianCloud = LoadGaussianCloud(opt);
+    if (!gaussianCloud)
+    {
+        return false;
+    }
+
+    std::string camerasFilename = opt.camerasFilename.empty() ? FindCamerasFile(opt.plyFilename) : opt.camerasFilename;
+    if (camerasFilename.empty())
+    {
+        Log::E("Could not find cameras.json, use --cameras\n");
+        return false;
+    }
+    CamerasConfig camerasConfig;
+    if (!camerasConfig.ImportJson(camerasFilename))
+    {
+        Log::E("Error loading \"%s\"\n", camerasFilename.c_str());
+        return false;
+    }
+
+    // only the stochastic modes accumulate, a single frame needs no history
+    const bool taa = opt.renderMode != "AB" && opt.taaFrames > 1;
+    const int frameCount = taa ? opt.taaFrames : 1;
+    auto splatRenderer = std::make_shared<splat::SplatRenderer>();
+    if (!splatRenderer->Init(gaussianCloud, false, false, opt.renderMode, 1, opt.width, opt.height, taa, false, 0, 0, false, 0))
+    {
+        Log::E("Error initializing splat renderer!\n");
+        return false;
+    }
+    // only the gpu copy is rendered from
+    gaussianCloud->ReleaseData(splatRenderer->GetGpuDataFetcher());
+
+    auto target = CreateTarget(opt.width, opt.height);
+    if (!target || !CreateOutDir(opt))
+    {
+        return false;
+    }
+    splatRenderer->SetPresentFbo(target->fbo);
+
+    const std::vector<Camera>& cameraVec = camerasConfig.GetCameraVec();
+    const glm::vec4 viewport(0.0f, 0.0f, (float)opt.width, (float)opt.height);
+    const glm::vec2 nearFar(Z_NEAR, Z_FAR);
+    std::vector<float> pixels((size_t)opt.width * opt.height * 4);
+    std::cout << "rendering " << cameraVec.size() << " views, " << opt.renderMode << ", "
+              << opt.width << "x" << opt.height << ", " << frameCount << " frames per view" << std::endl;
+
+    for (size_t i = 0; i < cameraVec.size(); i++)
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        // vertical fov of the camera, the aspect ratio is the one of the output images
+        const glm::mat4& cameraMat = cameraVec[i].mat;
+        glm::mat4 projMat = glm::perspective(cameraVec[i].fov.y, (float)opt.width / (float)opt.height, Z_NEAR, Z_FAR);
+
+        // every view starts from an empty history and the same noise sequence, so outputs are reproducible
+        if (taa)
+        {
+            splatRenderer->resetTemporalTextures(opt.width, opt.height);
+        }
+        srand(SEED);
+
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            ClearTarget(target, opt.width, opt.height);
+            splatRenderer->Sort(cameraMat, projMat, nearFar);
+            splatRenderer->Render(cameraMat, projMat, viewport, nearFar);
+        }
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target->fbo);
+        glReadPixels(0, 0, opt.width, opt.height, GL_RGBA, GL_FLOAT, pixels.data());
+        GL_ERROR_CHECK("RenderViews");
+
+        char name[32];
+        snprintf(name, sizeof(name), "view_%04d.%s", (int)i, opt.format.c_str());
+        std::string filename = (std::filesystem::path(opt.outDir) / name).string();
+        if (!SaveView(opt, filename, pixels))
+        {
+            return false;
+        }
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::milli> elapsed = endTime - startTime;
+        std::cout << "    " << filename << ", " << elapsed.count() << " ms" << std::endl;
+    }
+
+    splatRenderer->SetPresentFbo(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+// renders the frames of a recording in order, with the recorded render modes and random seeds, so the
+// stochastic modes accumulate exactly the history they had when it was recorded
+static bool RenderReplay(const BatchOptions& optIn)
+{
+    CameraRecording replay;
+    if (!replay.ImportFile(optIn.replayFilename) || replay.GetNumFrames() == 0)
+    {
+        Log::E("Error loading camera recording \"%s\"\n", optIn.replayFilename.c_str());
+        return false;
+    }
+
+    // the size of the first view, a window or an eye, resizes during the recording are not replayed
+    BatchOptions opt = optIn;
+    const CameraRecording::Frame& firstFrame = replay.GetFrame(0);
+    opt.width = (int)firstFrame.views[0].viewport.z;
+    opt.height = (int)firstFrame.views[0].viewport.w;
+    if (opt.width <= 0 || opt.height <= 0)
+    {
+        Log::E("Camera recording \"%s\" has an empty viewport\n", opt.replayFilename.c_str());
+        return false;
+    }
+
+    auto gaussianCloud = LoadGaussianCloud(opt);
+    if (!gaussianCloud)
+    {
+        return false;
+    }
+
+    auto splatRenderer = std::make_shared<splat::SplatRenderer>();
+    if (!splatRenderer->Init(gaussianCloud, false, false, firstFrame.renderMode, 1, opt.width, opt.height, true, false, 0, 0, false, 0))
+    {
+        Log::E("Error initializing splat renderer!\n");
+        return false;
+    }
+    // only the gpu copy is rendered from
+    gaussianCloud->ReleaseData(splatRenderer->GetGpuDataFetcher());
+
+    auto target = CreateTarget(opt.width, opt.height);
+    if (!target || !CreateOutDir(opt))
+    {
+        return false;
+    }
+    splatRenderer->SetPresentFbo(target->fbo);
+
+    std::string csvFilename = (std::filesystem::path(opt.outDir) / "replay.csv").string();
+    std::ofstream csv(csvFilename, std::ofstream::out);
+    if (!csv.good())
+    {
+        Log::E("Could not open \"%s\"\n", csvFilename.c_str());
+        return false;
+    }
+    csv << "frame,render_mode,sort_ms,render_ms,frame_ms,draw_count,sort_count\n";
+
+    const glm::vec4 viewport(0.0f, 0.0f, (float)opt.width, (float)opt.height);
+    std::vector<float> pixels((size_t)opt.width * opt.height * 4);
+    std::cout << "replaying " << replay.GetNumFrames() << " frames of " << opt.replayFilename << ", "
+              << opt.width << "x" << opt.height << std::endl;
+
+    double slowestMs = 0.0;
+    size_t slowestFrame = 0;
+    for (size_t i = 0; i < replay.GetNumFrames(); i++)
+    {
+        const CameraRecording::Frame& frame = replay.GetFrame(i);
+        const CameraRecording::View& view = frame.views[0];
+        if (frame.renderMode != splatRenderer->GetRenderMode() && !splatRenderer->SetRenderMode(frame.renderMode))
+        {
+            Log::E("Error switching to render mode %s\n", frame.renderMode.c_str());
+            return false;
+        }
+        srand(frame.seed);
+
+        // glFinish() makes the cpu times include the gpu work of the frame
+        auto sortStart = std::chrono::steady_clock::now();
+        ClearTarget(target, opt.width, opt.height);
+        splatRenderer->Sort(view.cameraMat, view.projMat, view.nearFar);
+        auto renderStart = std::chrono::steady_clock::now();
+        splatRenderer->Render(view.cameraMat, view.projMat, viewport, view.nearFar);
+        glFinish();
+        auto renderEnd = std::chrono::steady_clock::now();
+        GL_ERROR_CHECK("RenderReplay");
+
+        double sortMs = std::chrono::duration<double, std::milli>(renderStart - sortStart).count();
+        double renderMs = std::chrono::duration<double, std::milli>(renderEnd - renderStart).count();
+        double frameMs = sortMs + renderMs;
+        splat::SplatRenderer::FrameStats stats = splatRenderer->ReadFrameStats();
+        csv << i << "," << frame.renderMode << "," << sortMs << "," << renderMs << "," << frameMs << ","
+            << stats.drawCount << "," << stats.sortCount << "\n";
+        if (frameMs > slowestMs)
+        {
+            slowestMs = frameMs;
+            slowestFrame = i;
+        }
+
+        if (opt.replayImages)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, target->fbo);
+            glReadPixels(0, 0, opt.width, opt.height, GL_RGBA, GL_FLOAT, pixels.data());
+
+            char name[32];
+            snprintf(name, sizeof(name), "frame_%05d.%s", (int)i, opt.format.c_str());
+            if (!SaveView(opt, (std::filesystem::path(opt.outDir) / name).string(), pixels))
+            {
+                return false;
+            }
+        }
+    }
+
+    std::cout << "    " << csvFilename << ", slowest frame " << slowestFrame << ", " << slowestMs << " ms" << std::endl;
+
+    splatRenderer->SetPresentFbo(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return csv.good();
+}
+
+int main(int argc, char *argv[])
+{
+    Log::SetAppName("splatapult_batch");
+
+    BatchOptions opt;
+    if (!ParseArguments(argc, (const char**)argv, opt))
+    {
+        return 1;
+    }
+    Log::SetLevel(opt.debugLogging ? Log::Debug : Log::Warning);
+
+    EGLState egl;
+    if (!InitEGL(egl))
+    {
+        ShutdownEGL(egl);
+        return 1;
+    }
+
+    GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // a glx build of glew reports this without an X server, the gl entry points are loaded regardless
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY)
+    {
+        err = GLEW_OK;
+    }
+#endif
+    if (err != GLEW_OK)
+    {
+        Log::E("Error: %s\n", glewGetErrorString(err));
+        ShutdownEGL(egl);
+        return 1;
+    }
+    Log::D("GL_RENDERER = %s\n", (const char*)glGetString(GL_RENDERER));
+
+    // gl objects are released in RenderViews and RenderReplay, before the context goes away
+    bool success = opt.replayFilename.empty() ? RenderViews(opt) : RenderReplay(opt);
+
+    ShutdownEGL(egl);
+    return success ? 0 : 1;
+}
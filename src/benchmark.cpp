@@ -0,0 +1,282 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+#include "core/log.h"
+#include "core/util.h"
+
+#include "camerasconfig.h"
+
+Benchmark::Benchmark(const std::vector<Camera>& cameraVecIn, const Options& optionsIn) :
+    cameraVec(cameraVecIn),
+    options(optionsIn)
+{
+    // a single camera is benchmarked in place
+    int segmentCount = std::max((int)cameraVec.size() - 1, 1);
+    recordFrames = segmentCount * std::max(options.framesPerCamera, 1);
+    sampleVec.reserve(recordFrames);
+}
+
+Benchmark::Benchmark(const std::vector<glm::mat4>& pathIn, const Options& optionsIn) :
+    path(pathIn),
+    options(optionsIn)
+{
+    recordFrames = (int)path.size();
+    sampleVec.reserve(recordFrames);
+}
+
+bool Benchmark::IsDone() const
+{
+    return (cameraVec.empty() && path.empty()) || frame >= options.warmupFrames + recordFrames;
+}
+
+int Benchmark::GetPathFrame() const
+{
+    return std::max(std::min(frame - options.warmupFrames, recordFrames - 1), 0);
+}
+
+glm::mat4 Benchmark::GetCameraMat() const
+{
+    if (!path.empty())
+    {
+        return path[GetPathFrame()];
+    }
+    if (cameraVec.empty())
+    {
+        return glm::mat4(1.0f);
+    }
+    if (IsWarmingUp() || cameraVec.size() == 1)
+    {
+        return cameraVec[0].mat;
+    }
+
+    const int framesPerCamera = std::max(options.framesPerCamera, 1);
+    int pathFrame = GetPathFrame();
+    size_t i = pathFrame / framesPerCamera;
+    float t = (float)(pathFrame % framesPerCamera) / (float)framesPerCamera;
+
+    glm::vec3 scale, pos0, pos1;
+    glm::quat rot0, rot1;
+    Decompose(cameraVec[i].mat, &scale, &rot0, &pos0);
+    Decompose(cameraVec[i + 1].mat, &scale, &rot1, &pos1);
+    return MakeMat4(SafeMix(rot0, rot1, t), glm::mix(pos0, pos1, t));
+}
+
+void Benchmark::AddSample(const Sample& sample)
+{
+    if (!IsWarmingUp() && !IsDone())
+    {
+        sampleVec.push_back(sample);
+    }
+    frame++;
+}
+
+void Benchmark::AddGpuResults(const std::vector<GpuProfiler::ZoneResult>& results)
+{
+    if (IsWarmingUp() || IsDone())
+    {
+        return;
+    }
+
+    // zones that ran more than once, e.g. the render stages of both eyes, are summed
+    std::map<std::string, double> frameMs;
+    for (auto&& result : results)
+    {
+        frameMs[result.name] += result.ms;
+        if (gpuZoneMs.find(result.name) == gpuZoneMs.end())
+        {
+            gpuZoneNames.push_back(result.name);
+            gpuZoneMs[result.name].reserve(recordFrames);
+        }
+    }
+    for (auto&& iter : frameMs)
+    {
+        gpuZoneMs[iter.first].push_back(iter.second);
+    }
+}
+
+void Benchmark::AddPipelineStats(const GpuProfiler::PipelineStats& stats)
+{
+    if (!IsWarmingUp() && !IsDone())
+    {
+        pipelineStatsVec.push_back(stats);
+    }
+}
+
+Benchmark::Stats Benchmark::ComputeStats(double Sample::* member) const
+{
+    std::vector<double> values;
+    values.reserve(sampleVec.size());
+    for (auto&& sample : sampleVec)
+    {
+        values.push_back(sample.*member);
+    }
+    return ComputeStats(values);
+}
+
+Benchmark::Stats Benchmark::ComputeStats(std::vector<double> values)
+{
+    Stats stats;
+    if (values.empty())
+    {
+        return stats;
+    }
+
+    double sum = 0.0;
+    for (double v : values)
+    {
+        sum += v;
+    }
+    std::sort(values.begin(), values.end());
+
+    // nearest rank
+    auto percentile = [&values](double p)
+    {
+        size_t rank = (size_t)std::ceil(p * values.size());
+        return values[std::min(std::max(rank, (size_t)1), values.size()) - 1];
+    };
+    stats.mean = sum / values.size();
+    stats.p50 = percentile(0.5);
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    stats.min = values.front();
+    stats.max = values.back();
+    return stats;
+}
+
+bool Benchmark::WriteReport(const std::string& filename, const Info& info) const
+{
+    std::ofstream ofs(filename, std::ofstream::out);
+    if (!ofs.good())
+    {
+        Log::E("Could not open benchmark report \"%s\"\n", filename.c_str());
+        return false;
+    }
+
+    std::string extension = filename.size() > 4 ? filename.substr(filename.size() - 4) : "";
+    if (extension == ".csv")
+    {
+        ofs << "frame,frame_ms,sort_ms,render_ms,draw_count,sort_count\n";
+        for (size_t i = 0; i < sampleVec.size(); i++)
+        {
+            const Sample& s = sampleVec[i];
+            ofs << i << "," << s.frameMs << "," << s.sortMs << "," << s.renderMs << ","
+                << s.drawCount << "," << s.sortCount << "\n";
+        }
+        return ofs.good();
+    }
+
+    auto statsJson = [](const Stats& stats)
+    {
+        return nlohmann::json{{"mean", stats.mean}, {"p50", stats.p50}, {"p95", stats.p95},
+                              {"p99", stats.p99}, {"min", stats.min}, {"max", stats.max}};
+    };
+
+    double drawSum = 0.0, sortSum = 0.0;
+    nlohmann::json frames = nlohmann::json::array();
+    for (auto&& s : sampleVec)
+    {
+        frames.push_back({{"frame_ms", s.frameMs}, {"sort_ms", s.sortMs}, {"render_ms", s.renderMs},
+                          {"draw_count", s.drawCount}, {"sort_count", s.sortCount}});
+        drawSum += s.drawCount;
+        sortSum += s.sortCount;
+    }
+    double count = sampleVec.empty() ? 1.0 : (double)sampleVec.size();
+
+    nlohmann::json report;
+    report["scene"] = info.plyFilename;
+    report["render_mode"] = info.renderMode;
+    report["gl_renderer"] = info.glRenderer;
+    report["gl_version"] = info.glVersion;
+    report["width"] = info.width;
+    report["height"] = info.height;
+    report["splat_count"] = info.splatCount;
+    if (path.empty())
+    {
+        report["camera_count"] = cameraVec.size();
+        report["frames_per_camera"] = options.framesPerCamera;
+    }
+    else
+    {
+        report["replay_frames"] = path.size();
+    }
+    report["warmup_frames"] = options.warmupFrames;
+    report["frame_ms"] = statsJson(ComputeStats(&Sample::frameMs));
+    report["sort_ms"] = statsJson(ComputeStats(&Sample::sortMs));
+    report["render_ms"] = statsJson(ComputeStats(&Sample::renderMs));
+    nlohmann::json gpu = nlohmann::json::object();
+    for (auto&& name : gpuZoneNames)
+    {
+        gpu[name] = statsJson(ComputeStats(gpuZoneMs.at(name)));
+    }
+    report["gpu_ms"] = gpu;
+    if (!pipelineStatsVec.empty())
+    {
+        typedef uint64_t GpuProfiler::PipelineStats::* Counter;
+        auto counterStats = [this](Counter counter, double scale)
+        {
+            std::vector<double> values;
+            values.reserve(pipelineStatsVec.size());
+            for (auto&& stats : pipelineStatsVec)
+            {
+                values.push_back((double)(stats.*counter) * scale);
+            }
+            return ComputeStats(values);
+        };
+        double pixels = (double)std::max(info.width * info.height, 1);
+        nlohmann::json pipeline;
+        pipeline["splats_submitted"] = statsJson(counterStats(&GpuProfiler::PipelineStats::verticesSubmitted, 1.0));
+        pipeline["vertex_shader_invocations"] = statsJson(counterStats(&GpuProfiler::PipelineStats::vertexShaderInvocations, 1.0));
+        pipeline["geometry_shader_invocations"] = statsJson(counterStats(&GpuProfiler::PipelineStats::geometryShaderInvocations, 1.0));
+        pipeline["geometry_shader_primitives"] = statsJson(counterStats(&GpuProfiler::PipelineStats::geometryShaderPrimitives, 1.0));
+        pipeline["clipping_input_primitives"] = statsJson(counterStats(&GpuProfiler::PipelineStats::clippingInputPrimitives, 1.0));
+        pipeline["clipping_output_primitives"] = statsJson(counterStats(&GpuProfiler::PipelineStats::clippingOutputPrimitives, 1.0));
+        pipeline["fragment_shader_invocations"] = statsJson(counterStats(&GpuProfiler::PipelineStats::fragmentShaderInvocations, 1.0));
+        pipeline["fragments_per_pixel"] = statsJson(counterStats(&GpuProfiler::PipelineStats::fragmentShaderInvocations, 1.0 / pixels));
+        report["pipeline"] = pipeline;
+    }
+    report["mean_draw_count"] = drawSum / count;
+    report["mean_sort_count"] = sortSum / count;
+    report["frames"] = frames;
+
+    ofs << report.dump(4) << std::endl;
+    return ofs.good();
+}
+
+void Benchmark::PrintSummary() const
+{
+    Stats frameStats = ComputeStats(&Sample::frameMs);
+    Stats sortStats = ComputeStats(&Sample::sortMs);
+    Stats renderStats = ComputeStats(&Sample::renderMs);
+    std::cout << "benchmark, " << sampleVec.size() << " frames" << std::endl;
+    std::cout << "    frame ms: mean = " << frameStats.mean << ", p50 = " << frameStats.p50
+              << ", p95 = " << frameStats.p95 << ", p99 = " << frameStats.p99 << std::endl;
+    std::cout << "    cpu sort ms: mean = " << sortStats.mean << ", cpu render ms: mean = " << renderStats.mean << std::endl;
+    for (auto&& name : gpuZoneNames)
+    {
+        Stats gpuStats = ComputeStats(gpuZoneMs.at(name));
+        std::cout << "    gpu " << name << " ms: mean = " << gpuStats.mean << ", p95 = " << gpuStats.p95 << std::endl;
+    }
+    if (!pipelineStatsVec.empty())
+    {
+        double submitted = 0.0, emitted = 0.0, fragments = 0.0;
+        for (auto&& stats : pipelineStatsVec)
+        {
+            submitted += (double)stats.verticesSubmitted;
+            emitted += (double)stats.geometryShaderPrimitives;
+            fragments += (double)stats.fragmentShaderInvocations;
+        }
+        double count = (double)pipelineStatsVec.size();
+        std::cout << "    splats submitted: mean = " << submitted / count << ", after geometry shader: mean = "
+                  << emitted / count << ", fragments: mean = " << fragments / count << std::endl;
+    }
+}
@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "core/gpuprofiler.h"
+
+struct Camera;
+
+// Flies a fixed path through the cameras of cameras.json, or a recorded one, and collects per frame timings,
+// so runs can be compared across builds, gpus and render modes.
+class Benchmark
+{
+public:
+    struct Options
+    {
+        int warmupFrames = 60;      // rendered from the first camera, not recorded
+        int framesPerCamera = 30;   // frames spent moving from one camera to the next
+    };
+
+    struct Sample
+    {
+        double frameMs;     // time between the starts of two frames, including present
+        double sortMs;      // cpu time in SplatRenderer::Sort()
+        double renderMs;    // cpu time in SplatRenderer::Render()
+        uint32_t drawCount;
+        uint32_t sortCount;
+    };
+
+    // describes the run in the report
+    struct Info
+    {
+        std::string plyFilename;
+        std::string renderMode;
+        std::string glRenderer;
+        std::string glVersion;
+        int width;
+        int height;
+        uint32_t splatCount;
+    };
+
+    Benchmark(const std::vector<Camera>& cameraVecIn, const Options& optionsIn);
+    // follows a recorded path exactly, one camera per frame, framesPerCamera is not used
+    Benchmark(const std::vector<glm::mat4>& pathIn, const Options& optionsIn);
+
+    bool IsDone() const;
+    bool IsWarmingUp() const { return frame < options.warmupFrames; }
+    int GetFrame() const { return frame; }
+    // index into the path or the cameras' segments, 0 while warming up
+    int GetPathFrame() const;
+
+    // camera of the current frame, positions are interpolated linearly and rotations slerped
+    glm::mat4 GetCameraMat() const;
+
+    // records the current frame, if it is past the warmup, and advances to the next one
+    void AddSample(const Sample& sample);
+    // gpu time per zone of one frame, results arrive a few frames late and frames may be missing
+    void AddGpuResults(const std::vector<GpuProfiler::ZoneResult>& results);
+    // pipeline statistics of the splat draws of one frame, arrive along with the gpu results
+    void AddPipelineStats(const GpuProfiler::PipelineStats& stats);
+
+    // a .csv filename writes one row per frame, anything else json with a summary and every frame
+    bool WriteReport(const std::string& filename, const Info& info) const;
+    void PrintSummary() const;
+
+protected:
+    struct Stats
+    {
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+    };
+    static Stats ComputeStats(std::vector<double> values);
+    Stats ComputeStats(double Sample::* member) const;
+
+    std::vector<Camera> cameraVec;
+    std::vector<glm::mat4> path;
+    Options options;
+    int frame = 0;
+    int recordFrames = 0;
+    std::vector<Sample> sampleVec;
+    // zone names in the order they were first seen
+    std::vector<std::string> gpuZoneNames;
+    std::map<std::string, std::vector<double>> gpuZoneMs;
+    std::vector<GpuProfiler::PipelineStats> pipelineStatsVec;
+};
@@ -0,0 +1,180 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "camerarecording.h"
+
+#include <string.h>
+
+#include "core/log.h"
+
+// File layout, native byte order, which is little endian on every supported platform:
+//     char magic[8], uint32_t version
+// then per frame:
+//     float dt, int32_t width, int32_t height, uint32_t seed,
+//     uint8_t modeLength, char mode[modeLength], uint8_t viewCount,
+//     per view: float cameraMat[16], float projMat[16], float viewport[4], float nearFar[2]
+static const char MAGIC[8] = {'S', 'P', 'L', 'A', 'T', 'R', 'E', 'C'};
+static const uint32_t VERSION = 1;
+static const size_t MAX_VIEWS = 255;
+
+template <typename T>
+static void Write(std::ofstream& ofs, const T& value)
+{
+    ofs.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool Read(std::ifstream& ifs, T& value)
+{
+    return (bool)ifs.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+CameraRecording::CameraRecording()
+{
+}
+
+bool CameraRecording::OpenForWrite(const std::string& filenameIn)
+{
+    Close();
+    filename = filenameIn;
+    ofs.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs.good())
+    {
+        Log::E("Could not open camera recording \"%s\"\n", filename.c_str());
+        return false;
+    }
+    ofs.write(MAGIC, sizeof(MAGIC));
+    Write(ofs, VERSION);
+    return ofs.good();
+}
+
+void CameraRecording::BeginFrame(float dt, const glm::ivec2& windowSize, const std::string& renderMode, uint32_t seed)
+{
+    pendingFrame.dt = dt;
+    pendingFrame.windowSize = windowSize;
+    pendingFrame.renderMode = renderMode;
+    pendingFrame.seed = seed;
+    pendingFrame.views.clear();
+}
+
+void CameraRecording::AddView(const View& view)
+{
+    pendingFrame.views.push_back(view);
+}
+
+bool CameraRecording::EndFrame()
+{
+    if (!ofs.is_open())
+    {
+        return false;
+    }
+    if (pendingFrame.views.empty())
+    {
+        return true;
+    }
+    bool result = WriteFrame(pendingFrame);
+    pendingFrame.views.clear();
+    return result;
+}
+
+bool CameraRecording::WriteFrame(const Frame& frame)
+{
+    if (frame.renderMode.size() > 255 || frame.views.size() > MAX_VIEWS)
+    {
+        Log::E("CameraRecording: frame can not be written\n");
+        return false;
+    }
+
+    Write(ofs, frame.dt);
+    Write(ofs, (int32_t)frame.windowSize.x);
+    Write(ofs, (int32_t)frame.windowSize.y);
+    Write(ofs, frame.seed);
+    Write(ofs, (uint8_t)frame.renderMode.size());
+    ofs.write(frame.renderMode.data(), frame.renderMode.size());
+    Write(ofs, (uint8_t)frame.views.size());
+    for (auto&& view : frame.views)
+    {
+        Write(ofs, view.cameraMat);
+        Write(ofs, view.projMat);
+        Write(ofs, view.viewport);
+        Write(ofs, view.nearFar);
+    }
+
+    // a crash or a killed process still leaves every frame before it readable
+    ofs.flush();
+    if (!ofs.good())
+    {
+        Log::E("Error writing camera recording \"%s\"\n", filename.c_str());
+        ofs.close();
+        return false;
+    }
+    return true;
+}
+
+void CameraRecording::Close()
+{
+    if (ofs.is_open())
+    {
+        ofs.close();
+    }
+}
+
+bool CameraRecording::ImportFile(const std::string& filenameIn)
+{
+    std::ifstream ifs(filenameIn, std::ios::in | std::ios::binary);
+    if (!ifs.good())
+    {
+        Log::E("Could not open camera recording \"%s\"\n", filenameIn.c_str());
+        return false;
+    }
+
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    if (!ifs.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !Read(ifs, version))
+    {
+        Log::E("\"%s\" is not a camera recording\n", filenameIn.c_str());
+        return false;
+    }
+    if (version != VERSION)
+    {
+        Log::E("Camera recording \"%s\" has unsupported version %u\n", filenameIn.c_str(), version);
+        return false;
+    }
+
+    frameVec.clear();
+    while (ifs.peek() != std::ifstream::traits_type::eof())
+    {
+        Frame frame;
+        int32_t width = 0, height = 0;
+        uint8_t modeLength = 0, viewCount = 0;
+        bool ok = Read(ifs, frame.dt) && Read(ifs, width) && Read(ifs, height) &&
+            Read(ifs, frame.seed) && Read(ifs, modeLength);
+        if (ok)
+        {
+            frame.windowSize = glm::ivec2(width, height);
+            frame.renderMode.resize(modeLength);
+            ok = (bool)ifs.read(&frame.renderMode[0], modeLength) && Read(ifs, viewCount);
+        }
+        frame.views.resize(viewCount);
+        for (size_t i = 0; ok && i < frame.views.size(); i++)
+        {
+            View& view = frame.views[i];
+            ok = Read(ifs, view.cameraMat) && Read(ifs, view.projMat) && Read(ifs, view.viewport) && Read(ifs, view.nearFar);
+        }
+
+        // a recording that was cut off keeps the frames before the partial one
+        if (!ok)
+        {
+            Log::W("Camera recording \"%s\" is truncated after %d frames\n", filenameIn.c_str(), (int)frameVec.size());
+            break;
+        }
+        if (!frame.views.empty())
+        {
+            frameVec.push_back(frame);
+        }
+    }
+
+    return true;
+}
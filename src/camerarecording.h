@@ -0,0 +1,61 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#pragma once
+
+#include <fstream>
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// The views of every rendered frame of a session, along with the state that decides what the splat
+// renderer draws: window size, render mode and the random seed of the stochastic modes. Written to a
+// compact binary file while the session runs and read back to render the exact same frames again,
+// in the viewer or headless with splatapult_batch.
+class CameraRecording
+{
+public:
+    struct View
+    {
+        glm::mat4 cameraMat;  // inverse view matrix, the magic carpet included in vr
+        glm::mat4 projMat;
+        glm::vec4 viewport;
+        glm::vec2 nearFar;
+    };
+
+    struct Frame
+    {
+        float dt = 0.0f;
+        glm::ivec2 windowSize = {0, 0};
+        std::string renderMode;
+        uint32_t seed = 0;  // passed to srand() before the frame is rendered
+        std::vector<View> views;  // one per eye, splats are sorted for the first one
+    };
+
+    CameraRecording();
+
+    // frames are appended to the file as they end, the file is complete after each one
+    bool OpenForWrite(const std::string& filename);
+    bool IsOpenForWrite() const { return ofs.is_open(); }
+    void BeginFrame(float dt, const glm::ivec2& windowSize, const std::string& renderMode, uint32_t seed);
+    // called once per eye between BeginFrame() and EndFrame()
+    void AddView(const View& view);
+    // frames without views, e.g. while the xr session is not ready, are dropped
+    bool EndFrame();
+    void Close();
+
+    bool ImportFile(const std::string& filename);
+    size_t GetNumFrames() const { return frameVec.size(); }
+    const Frame& GetFrame(size_t i) const { return frameVec[i]; }
+
+protected:
+    bool WriteFrame(const Frame& frame);
+
+    std::ofstream ofs;
+    std::string filename;
+    Frame pendingFrame;
+    std::vector<Frame> frameVec;
+};
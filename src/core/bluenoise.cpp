@@ -0,0 +1,172 @@
+/*
+    Copyright (c) 2025 Shakiba Kheradmand
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "bluenoise.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#include "traceprofiler.h"
+#endif
+
+namespace
+{
+
+// Gaussian energy field over a torus, so the resulting tile wraps seamlessly.
+struct EnergyField
+{
+    EnergyField(uint32_t sizeIn) : size(sizeIn), kernel(sizeIn * sizeIn), energy(sizeIn * sizeIn, 0.0f)
+    {
+        const float SIGMA = 1.5f;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                // shortest toroidal distance
+                float dx = (float)std::min(x, size - x);
+                float dy = (float)std::min(y, size - y);
+                kernel[y * size + x] = expf(-(dx * dx + dy * dy) / (2.0f * SIGMA * SIGMA));
+            }
+        }
+    }
+
+    void Splat(uint32_t index, float sign)
+    {
+        const uint32_t px = index % size;
+        const uint32_t py = index / size;
+        const uint32_t mask = size - 1;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            const float* row = &kernel[((y - py) & mask) * size];
+            float* out = &energy[y * size];
+            for (uint32_t x = 0; x < size; x++)
+            {
+                out[x] += sign * row[(x - px) & mask];
+            }
+        }
+    }
+
+    // tightest cluster, the set pixel with the most energy
+    uint32_t FindCluster(const std::vector<bool>& pattern) const
+    {
+        uint32_t best = 0;
+        float bestEnergy = -1.0f;
+        for (uint32_t i = 0; i < (uint32_t)pattern.size(); i++)
+        {
+            if (pattern[i] && energy[i] > bestEnergy)
+            {
+                bestEnergy = energy[i];
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    // largest void, the unset pixel with the least energy
+    uint32_t FindVoid(const std::vector<bool>& pattern) const
+    {
+        uint32_t best = 0;
+        float bestEnergy = INFINITY;
+        for (uint32_t i = 0; i < (uint32_t)pattern.size(); i++)
+        {
+            if (!pattern[i] && energy[i] < bestEnergy)
+            {
+                bestEnergy = energy[i];
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    uint32_t size;
+    std::vector<float> kernel;
+    std::vector<float> energy;
+};
+
+}
+
+std::vector<uint8_t> GenerateBlueNoise(uint32_t size, uint32_t seed)
+{
+    ZoneScoped;
+
+    assert(size > 0 && (size & (size - 1)) == 0);
+    const uint32_t numPixels = size * size;
+
+    // random initial pattern with ~10% of the pixels set
+    std::mt19937 rng(seed);
+    std::vector<bool> pattern(numPixels, false);
+    uint32_t numOnes = std::max(numPixels / 10, 1u);
+    for (uint32_t i = 0; i < numOnes;)
+    {
+        uint32_t index = rng() % numPixels;
+        if (!pattern[index])
+        {
+            pattern[index] = true;
+            i++;
+        }
+    }
+
+    EnergyField field(size);
+    for (uint32_t i = 0; i < numPixels; i++)
+    {
+        if (pattern[i])
+        {
+            field.Splat(i, 1.0f);
+        }
+    }
+
+    // move points from the tightest cluster to the largest void until the pattern is stable
+    for (;;)
+    {
+        uint32_t cluster = field.FindCluster(pattern);
+        pattern[cluster] = false;
+        field.Splat(cluster, -1.0f);
+
+        uint32_t hole = field.FindVoid(pattern);
+        pattern[hole] = true;
+        field.Splat(hole, 1.0f);
+
+        if (hole == cluster)
+        {
+            break;
+        }
+    }
+
+    std::vector<uint32_t> rank(numPixels, 0);
+
+    // phase 1, rank the initial points by removing the tightest clusters first
+    {
+        std::vector<bool> prototype = pattern;
+        EnergyField protoField = field;
+        for (uint32_t r = numOnes; r > 0; r--)
+        {
+            uint32_t cluster = protoField.FindCluster(prototype);
+            prototype[cluster] = false;
+            protoField.Splat(cluster, -1.0f);
+            rank[cluster] = r - 1;
+        }
+    }
+
+    // phase 2 and 3, fill the largest voids until every pixel has a rank
+    for (uint32_t r = numOnes; r < numPixels; r++)
+    {
+        uint32_t hole = field.FindVoid(pattern);
+        pattern[hole] = true;
+        field.Splat(hole, 1.0f);
+        rank[hole] = r;
+    }
+
+    std::vector<uint8_t> result(numPixels);
+    for (uint32_t i = 0; i < numPixels; i++)
+    {
+        result[i] = (uint8_t)((rank[i] * 256) / numPixels);
+    }
+    return result;
+}
@@ -0,0 +1,15 @@
+/*
+    Copyright (c) 2025 Shakiba Kheradmand
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+// blue noise generation
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Builds a size x size tileable blue noise dither mask with the void-and-cluster method.
+// size must be a power of two. Returns one byte per pixel, ranks spread evenly over [0, 255].
+std::vector<uint8_t> GenerateBlueNoise(uint32_t size, uint32_t seed);
@@ -17,35 +17,48 @@
 #include <SDL2/SDL_opengl_glext.h>
 #endif
 
+#include <cstddef>
+#include <cstring>
 #include <memory>
 #include <vector>
 
 #include "log.h"
 #include "util.h"
 #include "program.h"
+#include "streambuffer.h"
 
 DebugRenderer::DebugRenderer()
 {
 
 }
 
-bool DebugRenderer::Init()
+DebugRenderer::~DebugRenderer()
 {
+    if (vao)
+    {
+        glDeleteVertexArrays(1, &vao);
+    }
+}
+
+bool DebugRenderer::Init(std::shared_ptr<StreamBuffer> streamBufferIn)
+{
+    streamBuffer = streamBufferIn;
+
     ddProg = std::make_shared<Program>();
     if (!ddProg->LoadVertFrag("shader/debugdraw_vert.glsl", "shader/debugdraw_frag.glsl"))
     {
         Log::E("Error loading DebugRenderer shader!\n");
         return false;
     }
+
+    glGenVertexArrays(1, &vao);
     return true;
 }
 
 void DebugRenderer::Line(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color)
 {
-    linePositionVec.push_back(start);
-    linePositionVec.push_back(end);
-    lineColorVec.push_back(color);
-    lineColorVec.push_back(color);
+    lineVertexVec.push_back({start, color});
+    lineVertexVec.push_back({end, color});
 }
 
 void DebugRenderer::Transform(const glm::mat4& m, float axisLen)
@@ -66,16 +79,42 @@ void DebugRenderer::Transform(const glm::mat4& m, float axisLen)
 void DebugRenderer::Render(const glm::mat4& cameraMat, const glm::mat4& projMat,
                            const glm::vec4& viewport, const glm::vec2& nearFar)
 {
+    // every view of a frame draws the same lines, only the first one uploads them
+    if (uploadFrame != streamBuffer->GetFrame())
+    {
+        uploadFrame = streamBuffer->GetFrame();
+        uploadCount = 0;
+        size_t size = lineVertexVec.size() * sizeof(Vertex);
+        void* ptr = size > 0 ? streamBuffer->Map(size, &uploadOffset) : nullptr;
+        if (ptr)
+        {
+            memcpy(ptr, lineVertexVec.data(), size);
+            streamBuffer->Unmap();
+            uploadCount = lineVertexVec.size();
+        }
+    }
+
+    if (uploadCount == 0)
+    {
+        return;
+    }
+
     ddProg->Bind();
     glm::mat4 modelViewProjMat = projMat * glm::inverse(cameraMat);
     ddProg->SetUniform("modelViewProjMat", modelViewProjMat);
-    ddProg->SetAttrib("position", linePositionVec.data());
-    ddProg->SetAttrib("color", lineColorVec.data());
-    glDrawArrays(GL_LINES, 0, (GLsizei)linePositionVec.size());
+
+    // with a buffer bound the attrib pointers are offsets into it
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, streamBuffer->GetObj());
+    const uint8_t* base = (const uint8_t*)uploadOffset;
+    ddProg->SetAttrib("position", (glm::vec3*)(base + offsetof(Vertex, position)), sizeof(Vertex));
+    ddProg->SetAttrib("color", (glm::vec3*)(base + offsetof(Vertex, color)), sizeof(Vertex));
+    glDrawArrays(GL_LINES, 0, (GLsizei)uploadCount);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 }
 
 void DebugRenderer::EndFrame()
 {
-    linePositionVec.clear();
-    lineColorVec.clear();
+    lineVertexVec.clear();
 }
@@ -7,16 +7,20 @@
 
 #include <glm/glm.hpp>
 #include <memory>
+#include <stdint.h>
 #include <vector>
 
 class Program;
+class StreamBuffer;
 
 class DebugRenderer
 {
 public:
 	DebugRenderer();
+	~DebugRenderer();
 
-	bool Init();
+	// the lines of a frame are written into streamBufferIn, once per frame
+	bool Init(std::shared_ptr<StreamBuffer> streamBufferIn);
 
 	// viewport = (x, y, width, height)
 	void Render(const glm::mat4& cameraMat, const glm::mat4& projMat,
@@ -29,9 +33,20 @@ public:
 	void Transform(const glm::mat4& m, float axisLen = 1.0f);
 
 protected:
+	struct Vertex
+	{
+		glm::vec3 position;
+		glm::vec3 color;
+	};
+
 	std::shared_ptr<Program> ddProg;
-	std::vector<glm::vec3> linePositionVec;
-	std::vector<glm::vec3> lineColorVec;
+	std::vector<Vertex> lineVertexVec;
+
+	std::shared_ptr<StreamBuffer> streamBuffer;
+	uint32_t vao = 0;
+	uint64_t uploadFrame = UINT64_MAX;  // stream buffer frame the lines were last written in
+	size_t uploadOffset = 0;
+	size_t uploadCount = 0;
 };
 
 
@@ -0,0 +1,362 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "framecapture.h"
+
+#ifdef __ANDROID__
+#include <GLES3/gl3.h>
+#include <GLES3/gl3ext.h>
+#else
+#include <GL/glew.h>
+#endif
+
+#include <filesystem>
+#include <signal.h>
+#include <string.h>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+#include "image.h"
+#include "log.h"
+#include "traceprofiler.h"
+#include "util.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+FrameCapture::FrameCapture()
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    Stop();
+    for (auto&& slot : ring)
+    {
+        if (slot.pbo)
+        {
+            glDeleteBuffers(1, &slot.pbo);
+        }
+    }
+    if (textureFbo)
+    {
+        glDeleteFramebuffers(1, &textureFbo);
+    }
+}
+
+bool FrameCapture::StartPngSequence(const std::string& pattern)
+{
+    Stop();
+    pipeMode = false;
+    target = pattern;
+
+    std::filesystem::path dir = std::filesystem::path(pattern).parent_path();
+    if (!dir.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec)
+        {
+            Log::E("Could not create capture directory \"%s\"\n", dir.string().c_str());
+            return false;
+        }
+    }
+    return Start();
+}
+
+bool FrameCapture::StartPipe(const std::string& command)
+{
+    Stop();
+    pipeMode = true;
+    target = command;
+#ifndef _WIN32
+    // an encoder that exits early must not take the viewer down with it, fwrite() reports the error
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    return Start();
+}
+
+bool FrameCapture::Start()
+{
+    readIndex = 0;
+    writeIndex = 0;
+    droppedFrames = 0;
+    writtenFrames = 0;
+    writeFailed = false;
+    stopWriter = false;
+    writerThread = std::thread(&FrameCapture::WriterThread, this);
+    capturing = true;
+    return true;
+}
+
+void FrameCapture::Stop()
+{
+    if (!capturing)
+    {
+        return;
+    }
+
+    // the last frames are still on the gpu, this is the only place that waits for them
+    CollectReadbacks(true);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopWriter = true;
+    }
+    cv.notify_one();
+    writerThread.join();
+    capturing = false;
+
+    if (droppedFrames > 0)
+    {
+        Log::W("FrameCapture: %llu frames were dropped, the gpu readback or the writer could not keep up\n",
+               (unsigned long long)droppedFrames);
+    }
+    Log::I("FrameCapture: wrote %llu frames to \"%s\"\n", (unsigned long long)writtenFrames, target.c_str());
+}
+
+void FrameCapture::CaptureFramebuffer(uint32_t fbo, int width, int height)
+{
+    if (!capturing)
+    {
+        return;
+    }
+    BeginReadback(fbo, width, height);
+}
+
+void FrameCapture::CaptureTexture(uint32_t texture, int width, int height)
+{
+    if (!capturing || texture == 0)
+    {
+        return;
+    }
+
+    if (!textureFbo)
+    {
+        glGenFramebuffers(1, &textureFbo);
+    }
+    GLint prevFbo = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prevFbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, textureFbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, prevFbo);
+
+    BeginReadback(textureFbo, width, height);
+}
+
+void FrameCapture::BeginReadback(uint32_t fbo, int width, int height)
+{
+    ZoneScoped;
+
+    CollectReadbacks(false);
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+    if (writeIndex - readIndex == RING_SIZE)
+    {
+        droppedFrames++;
+        return;
+    }
+
+    Slot& slot = ring[writeIndex % RING_SIZE];
+    size_t size = (size_t)width * height * 4;
+    if (!slot.pbo)
+    {
+        glGenBuffers(1, &slot.pbo);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.size != size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.size = size;
+    }
+    slot.width = width;
+    slot.height = height;
+
+    GLint prevFbo = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prevFbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(fbo == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // returns immediately, the copy into the buffer happens on the gpu
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, prevFbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    writeIndex++;
+
+    GL_ERROR_CHECK("FrameCapture::BeginReadback()");
+}
+
+void FrameCapture::CollectReadbacks(bool wait)
+{
+    while (readIndex < writeIndex)
+    {
+        Slot& slot = ring[readIndex % RING_SIZE];
+        GLsync fence = (GLsync)slot.fence;
+        GLbitfield flags = wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+        GLuint64 timeout = wait ? 1000000000 : 0;
+        GLenum status = glClientWaitSync(fence, flags, timeout);
+        if (status == GL_TIMEOUT_EXPIRED && !wait)
+        {
+            // readbacks complete in order, the newer ones are not done either
+            return;
+        }
+        glDeleteSync(fence);
+        slot.fence = nullptr;
+        readIndex++;
+
+        if (status == GL_WAIT_FAILED || status == GL_TIMEOUT_EXPIRED)
+        {
+            droppedFrames++;
+            continue;
+        }
+
+        Frame frame;
+        frame.width = slot.width;
+        frame.height = slot.height;
+        size_t pixelCount = (size_t)slot.width * slot.height;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        const uint8_t* rgba = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+        if (rgba)
+        {
+            // the alpha of the default framebuffer is meaningless, it is dropped here instead of on the writer
+            // thread so the mapping is released right away
+            frame.rgb.resize(pixelCount * 3);
+            uint8_t* rgb = frame.rgb.data();
+            for (size_t i = 0; i < pixelCount; i++)
+            {
+                rgb[i * 3 + 0] = rgba[i * 4 + 0];
+                rgb[i * 3 + 1] = rgba[i * 4 + 1];
+                rgb[i * 3 + 2] = rgba[i * 4 + 2];
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!rgba)
+        {
+            droppedFrames++;
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (queue.size() >= MAX_QUEUED_FRAMES && !wait)
+            {
+                droppedFrames++;
+                continue;
+            }
+            queue.push_back(std::move(frame));
+        }
+        cv.notify_one();
+    }
+}
+
+void FrameCapture::WriterThread()
+{
+    TraceProfiler::SetThreadName("frame capture");
+    while (true)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stopWriter || !queue.empty(); });
+            if (queue.empty())
+            {
+                break;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        if (!writeFailed && !WriteFrame(frame))
+        {
+            // the remaining frames are discarded, the capture keeps running until it is stopped
+            writeFailed = true;
+        }
+    }
+
+    if (pipe)
+    {
+        int status = pclose(pipe);
+        pipe = nullptr;
+        if (status != 0)
+        {
+            Log::W("FrameCapture: \"%s\" exited with status %d\n", target.c_str(), status);
+        }
+    }
+}
+
+bool FrameCapture::WriteFrame(const Frame& frame)
+{
+    ZoneScoped;
+
+    if (!pipeMode)
+    {
+        char filename[1024];
+        snprintf(filename, sizeof(filename), target.c_str(), (int)writtenFrames);
+        Image image;
+        image.width = frame.width;
+        image.height = frame.height;
+        image.pixelFormat = PixelFormat::RGB;
+        image.isSRGB = true;
+        image.data = frame.rgb;
+        if (!image.Save(filename))
+        {
+            return false;
+        }
+        writtenFrames++;
+        return true;
+    }
+
+    if (!pipe)
+    {
+        // started on the first frame, once its size is known
+        std::string command = target;
+        std::string size = std::to_string(frame.width) + "x" + std::to_string(frame.height);
+        size_t pos = command.find("{size}");
+        if (pos != std::string::npos)
+        {
+            command.replace(pos, 6, size);
+        }
+#ifdef _WIN32
+        pipe = popen(command.c_str(), "wb");
+#else
+        pipe = popen(command.c_str(), "w");
+#endif
+        if (!pipe)
+        {
+            Log::E("FrameCapture: could not run \"%s\"\n", command.c_str());
+            return false;
+        }
+        pipeWidth = frame.width;
+        pipeHeight = frame.height;
+    }
+    if (frame.width != pipeWidth || frame.height != pipeHeight)
+    {
+        Log::E("FrameCapture: frame size changed to %dx%d, the encoder expects %dx%d\n", frame.width, frame.height,
+               pipeWidth, pipeHeight);
+        return false;
+    }
+
+    // raw video is top to bottom
+    size_t rowSize = (size_t)frame.width * 3;
+    for (int y = frame.height - 1; y >= 0; y--)
+    {
+        if (fwrite(frame.rgb.data() + y * rowSize, 1, rowSize, pipe) != rowSize)
+        {
+            Log::E("FrameCapture: error writing to \"%s\"\n", target.c_str());
+            return false;
+        }
+    }
+    writtenFrames++;
+    return true;
+}
@@ -0,0 +1,93 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Captures the final image of every frame as a png sequence or as raw frames piped into an encoder
+// process, e.g. ffmpeg. Pixels are read into a ring of pixel pack buffers, each one is copied out once
+// its fence has signaled, and a writer thread encodes them. The render thread never waits on the gpu
+// or the disk: when every buffer is still in flight or the writer falls behind, the frame is dropped.
+class FrameCapture
+{
+public:
+    // pixel pack buffers in flight, the gpu has this many frames to finish a readback
+    static const int RING_SIZE = 4;
+    // frames copied out of the ring and waiting for the writer thread
+    static const size_t MAX_QUEUED_FRAMES = 8;
+
+    FrameCapture();
+    ~FrameCapture();
+
+    // pattern is a printf format with one integer for the frame number, e.g. "capture/frame_%05d.png"
+    bool StartPngSequence(const std::string& pattern);
+    // command reads rgb24 frames from stdin, "{size}" in it is replaced with the frame size, e.g.
+    // "ffmpeg -y -f rawvideo -pix_fmt rgb24 -s {size} -r 60 -i - -pix_fmt yuv420p flythrough.mp4"
+    bool StartPipe(const std::string& command);
+    // reads back the frames still in flight, waits for the writer to finish and logs how many were dropped
+    void Stop();
+    bool IsCapturing() const { return capturing; }
+
+    // reads the color of a framebuffer, 0 for the default one, call after the frame is rendered
+    void CaptureFramebuffer(uint32_t fbo, int width, int height);
+    // reads mip 0 of a 2d texture, e.g. the last rendered xr swapchain image
+    void CaptureTexture(uint32_t texture, int width, int height);
+
+protected:
+    struct Slot
+    {
+        uint32_t pbo = 0;
+        void* fence = nullptr;  // GLsync
+        size_t size = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    struct Frame
+    {
+        int width;
+        int height;
+        std::vector<uint8_t> rgb;  // rows bottom to top, as read by glReadPixels
+    };
+
+    bool Start();
+    void BeginReadback(uint32_t fbo, int width, int height);
+    // copies out the readbacks that have completed, oldest first, wait blocks until they all have
+    void CollectReadbacks(bool wait);
+    void WriterThread();
+    bool WriteFrame(const Frame& frame);
+
+    bool capturing = false;
+    bool pipeMode = false;
+    std::string target;  // the png pattern or the encoder command
+
+    Slot ring[RING_SIZE];
+    uint64_t readIndex = 0;
+    uint64_t writeIndex = 0;
+    uint32_t textureFbo = 0;
+    uint64_t droppedFrames = 0;
+
+    // shared with the writer thread
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Frame> queue;
+    bool stopWriter = false;
+    std::thread writerThread;
+
+    // only touched by the writer thread
+    uint64_t writtenFrames = 0;
+    FILE* pipe = nullptr;
+    int pipeWidth = 0;
+    int pipeHeight = 0;
+    bool writeFailed = false;
+};
@@ -0,0 +1,485 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "gpuprofiler.h"
+
+#ifdef __ANDROID__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES3/gl3ext.h>
+#include <GLES2/gl2ext.h>
+#else
+#include <GL/glew.h>
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL2/SDL_opengl.h>
+#include <SDL2/SDL_opengl_glext.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "log.h"
+#include "util.h"
+
+// weight of the newest frame in the displayed averages
+static const double AVG_WEIGHT = 0.05;
+
+#ifdef __ANDROID__
+// GL_EXT_disjoint_timer_query, loaded by GpuProfiler::Init()
+static PFNGLQUERYCOUNTEREXTPROC queryCounterEXT = nullptr;
+static PFNGLGETQUERYOBJECTIVEXTPROC getQueryObjectivEXT = nullptr;
+static PFNGLGETQUERYOBJECTUI64VEXTPROC getQueryObjectui64vEXT = nullptr;
+
+static bool LoadDisjointTimerQuery()
+{
+    bool found = false;
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions && !found; i++)
+    {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        found = ext && strcmp(ext, "GL_EXT_disjoint_timer_query") == 0;
+    }
+    if (!found)
+    {
+        return false;
+    }
+    queryCounterEXT = (PFNGLQUERYCOUNTEREXTPROC)eglGetProcAddress("glQueryCounterEXT");
+    getQueryObjectivEXT = (PFNGLGETQUERYOBJECTIVEXTPROC)eglGetProcAddress("glGetQueryObjectivEXT");
+    getQueryObjectui64vEXT = (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress("glGetQueryObjectui64vEXT");
+    return queryCounterEXT && getQueryObjectivEXT && getQueryObjectui64vEXT;
+}
+
+static void QueryTimestamp(GLuint query)
+{
+    queryCounterEXT(query, GL_TIMESTAMP_EXT);
+}
+
+static bool IsQueryAvailable(GLuint query)
+{
+    GLint available = 0;
+    getQueryObjectivEXT(query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+    return available != 0;
+}
+
+static uint64_t GetQueryResult(GLuint query)
+{
+    GLuint64 result = 0;
+    getQueryObjectui64vEXT(query, GL_QUERY_RESULT_EXT, &result);
+    return result;
+}
+
+// set when something, e.g. a clock change, made the timestamps issued since the last check
+// meaningless. Reading it clears it.
+static bool IsGpuDisjoint()
+{
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    return disjoint != 0;
+}
+#else
+static void QueryTimestamp(GLuint query)
+{
+    glQueryCounter(query, GL_TIMESTAMP);
+}
+
+static bool IsQueryAvailable(GLuint query)
+{
+    GLint available = 0;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available != 0;
+}
+
+static uint64_t GetQueryResult(GLuint query)
+{
+    GLuint64 result = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+    return result;
+}
+
+static bool IsGpuDisjoint()
+{
+    return false;
+}
+
+// GL_ARB_pipeline_statistics_query targets and where their results go
+static const struct
+{
+    GLenum target;
+    uint64_t GpuProfiler::PipelineStats::* member;
+} STATS_QUERIES[] = {
+    {GL_VERTICES_SUBMITTED_ARB, &GpuProfiler::PipelineStats::verticesSubmitted},
+    {GL_VERTEX_SHADER_INVOCATIONS_ARB, &GpuProfiler::PipelineStats::vertexShaderInvocations},
+    {GL_GEOMETRY_SHADER_INVOCATIONS, &GpuProfiler::PipelineStats::geometryShaderInvocations},
+    {GL_GEOMETRY_SHADER_PRIMITIVES_EMITTED_ARB, &GpuProfiler::PipelineStats::geometryShaderPrimitives},
+    {GL_CLIPPING_INPUT_PRIMITIVES_ARB, &GpuProfiler::PipelineStats::clippingInputPrimitives},
+    {GL_CLIPPING_OUTPUT_PRIMITIVES_ARB, &GpuProfiler::PipelineStats::clippingOutputPrimitives},
+    {GL_FRAGMENT_SHADER_INVOCATIONS_ARB, &GpuProfiler::PipelineStats::fragmentShaderInvocations}
+};
+static const size_t STATS_QUERY_COUNT = sizeof(STATS_QUERIES) / sizeof(STATS_QUERIES[0]);
+#endif
+
+// 1234567 -> "1.23M"
+static std::string FormatCount(uint64_t count)
+{
+    char str[32];
+    if (count >= 1000000000)
+    {
+        snprintf(str, sizeof(str), "%.2fG", (double)count / 1e9);
+    }
+    else if (count >= 1000000)
+    {
+        snprintf(str, sizeof(str), "%.2fM", (double)count / 1e6);
+    }
+    else if (count >= 1000)
+    {
+        snprintf(str, sizeof(str), "%.1fK", (double)count / 1e3);
+    }
+    else
+    {
+        snprintf(str, sizeof(str), "%llu", (unsigned long long)count);
+    }
+    return str;
+}
+
+GpuProfiler::Zone::Zone(GpuProfiler* profilerIn, const char* name) : profiler(profilerIn)
+{
+    if (profiler)
+    {
+        profiler->BeginZone(name);
+    }
+}
+
+GpuProfiler::Zone::~Zone()
+{
+    if (profiler)
+    {
+        profiler->EndZone();
+    }
+}
+
+GpuProfiler::StatsRange::StatsRange(GpuProfiler* profilerIn) : profiler(profilerIn)
+{
+    if (profiler)
+    {
+        profiler->BeginStats();
+    }
+}
+
+GpuProfiler::StatsRange::~StatsRange()
+{
+    if (profiler)
+    {
+        profiler->EndStats();
+    }
+}
+
+GpuProfiler::GpuProfiler()
+{
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (auto&& fq : frameQueries)
+    {
+        if (!fq.queryPool.empty())
+        {
+            glDeleteQueries((GLsizei)fq.queryPool.size(), fq.queryPool.data());
+        }
+        if (!fq.statsQueryPool.empty())
+        {
+            glDeleteQueries((GLsizei)fq.statsQueryPool.size(), fq.statsQueryPool.data());
+        }
+    }
+}
+
+bool GpuProfiler::Init()
+{
+#ifdef __ANDROID__
+    supported = LoadDisjointTimerQuery();
+    if (supported)
+    {
+        // clears a disjoint left over from before the first query
+        IsGpuDisjoint();
+    }
+    // gles has no pipeline statistics queries
+    statsSupported = false;
+#else
+    // core since 3.3, drivers still list the extension
+    supported = GLEW_ARB_timer_query;
+    // core since 4.6
+    statsSupported = supported && GLEW_ARB_pipeline_statistics_query;
+#endif
+    if (!supported)
+    {
+        Log::W("GpuProfiler: timer queries are not supported\n");
+    }
+    else if (!statsSupported)
+    {
+        Log::W("GpuProfiler: pipeline statistics queries are not supported\n");
+    }
+    return supported;
+}
+
+void GpuProfiler::SetEnabled(bool enabledIn)
+{
+    if (enabled == enabledIn)
+    {
+        return;
+    }
+    enabled = enabledIn && supported;
+    // queries issued before the switch are of no interest
+    for (auto&& fq : frameQueries)
+    {
+        fq.pending = false;
+    }
+    results.clear();
+    avgMap.clear();
+    hasStats = false;
+}
+
+uint32_t GpuProfiler::AllocQuery(FrameQueries& fq)
+{
+    if (fq.queriesUsed == fq.queryPool.size())
+    {
+        // grows once, then the same queries are reused every FRAME_LATENCY frames
+        size_t prevSize = fq.queryPool.size();
+        fq.queryPool.resize(prevSize + 32);
+        glGenQueries(32, fq.queryPool.data() + prevSize);
+    }
+    return fq.queryPool[fq.queriesUsed++];
+}
+
+void GpuProfiler::BeginFrame()
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    FrameQueries& fq = frameQueries[frame % FRAME_LATENCY];
+    if (fq.pending)
+    {
+        CollectResults(fq);
+    }
+
+    fq.zones.clear();
+    fq.queriesUsed = 0;
+    fq.statsQueriesUsed = 0;
+    fq.frame = frame;
+    fq.pending = false;
+    zoneStack.clear();
+    inFrame = true;
+    inStats = false;
+
+    BeginZone("frame");
+}
+
+void GpuProfiler::EndFrame()
+{
+    if (!enabled || !inFrame)
+    {
+        return;
+    }
+
+    // closes the frame zone and anything left open
+    EndStats();
+    while (!zoneStack.empty())
+    {
+        EndZone();
+    }
+
+    frameQueries[frame % FRAME_LATENCY].pending = true;
+    inFrame = false;
+    frame++;
+}
+
+void GpuProfiler::BeginZone(const char* name)
+{
+    if (!enabled || !inFrame)
+    {
+        return;
+    }
+
+    FrameQueries& fq = frameQueries[frame % FRAME_LATENCY];
+    PendingZone zone;
+    zone.name = name;
+    zone.depth = (int)zoneStack.size();
+    zone.beginQuery = AllocQuery(fq);
+    zone.endQuery = 0;
+    QueryTimestamp(zone.beginQuery);
+    zoneStack.push_back(fq.zones.size());
+    fq.zones.push_back(zone);
+}
+
+void GpuProfiler::EndZone()
+{
+    if (!enabled || !inFrame || zoneStack.empty())
+    {
+        return;
+    }
+
+    FrameQueries& fq = frameQueries[frame % FRAME_LATENCY];
+    PendingZone& zone = fq.zones[zoneStack.back()];
+    zone.endQuery = AllocQuery(fq);
+    QueryTimestamp(zone.endQuery);
+    zoneStack.pop_back();
+}
+
+void GpuProfiler::BeginStats()
+{
+    if (!enabled || !inFrame || !statsSupported || inStats)
+    {
+        return;
+    }
+
+#ifndef __ANDROID__
+    FrameQueries& fq = frameQueries[frame % FRAME_LATENCY];
+    if (fq.statsQueriesUsed == fq.statsQueryPool.size())
+    {
+        // room for a few ranges at a time
+        size_t prevSize = fq.statsQueryPool.size();
+        fq.statsQueryPool.resize(prevSize + 4 * STATS_QUERY_COUNT);
+        glGenQueries((GLsizei)(4 * STATS_QUERY_COUNT), fq.statsQueryPool.data() + prevSize);
+    }
+    for (size_t i = 0; i < STATS_QUERY_COUNT; i++)
+    {
+        glBeginQuery(STATS_QUERIES[i].target, fq.statsQueryPool[fq.statsQueriesUsed + i]);
+    }
+    fq.statsQueriesUsed += STATS_QUERY_COUNT;
+    inStats = true;
+#endif
+}
+
+void GpuProfiler::EndStats()
+{
+    if (!inStats)
+    {
+        return;
+    }
+
+#ifndef __ANDROID__
+    for (size_t i = 0; i < STATS_QUERY_COUNT; i++)
+    {
+        glEndQuery(STATS_QUERIES[i].target);
+    }
+#endif
+    inStats = false;
+}
+
+void GpuProfiler::CollectStats(FrameQueries& fq)
+{
+#ifndef __ANDROID__
+    hasStats = false;
+    stats = PipelineStats();
+    if (fq.statsQueriesUsed == 0)
+    {
+        return;
+    }
+
+    // the statistics are not ordered with the timestamps, check the last one ended
+    GLint available = 0;
+    glGetQueryObjectiv(fq.statsQueryPool[fq.statsQueriesUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < fq.statsQueriesUsed; i++)
+    {
+        GLuint64 count = 0;
+        glGetQueryObjectui64v(fq.statsQueryPool[i], GL_QUERY_RESULT, &count);
+        stats.*(STATS_QUERIES[i % STATS_QUERY_COUNT].member) += count;
+    }
+    hasStats = true;
+#endif
+}
+
+void GpuProfiler::CollectResults(FrameQueries& fq)
+{
+    fq.pending = false;
+    if (fq.zones.empty())
+    {
+        return;
+    }
+
+    // the frame zone ends last and queries complete in order, once it is done all of them are
+    if (!IsQueryAvailable(fq.zones.front().endQuery))
+    {
+        Log::D("GpuProfiler: frame %llu not ready, dropped\n", (unsigned long long)fq.frame);
+        return;
+    }
+    if (IsGpuDisjoint())
+    {
+        Log::D("GpuProfiler: frame %llu disjoint, dropped\n", (unsigned long long)fq.frame);
+        return;
+    }
+
+    results.clear();
+    for (auto&& zone : fq.zones)
+    {
+        uint64_t begin = GetQueryResult(zone.beginQuery);
+        uint64_t end = GetQueryResult(zone.endQuery);
+
+        ZoneResult result;
+        result.name = zone.name;
+        result.depth = zone.depth;
+        result.ms = end > begin ? (double)(end - begin) / 1000000.0 : 0.0;
+        result.beginNs = (int64_t)begin;
+        result.endNs = (int64_t)end;
+
+        // zones that run more than once a frame, e.g. one per eye, share an average
+        auto iter = avgMap.find(result.name);
+        if (iter == avgMap.end())
+        {
+            iter = avgMap.insert(std::pair<std::string, double>(result.name, result.ms)).first;
+        }
+        else
+        {
+            iter->second += AVG_WEIGHT * (result.ms - iter->second);
+        }
+        result.avgMs = iter->second;
+        results.push_back(result);
+    }
+    CollectStats(fq);
+    resultsFrame = fq.frame;
+
+    GL_ERROR_CHECK("GpuProfiler::CollectResults()");
+}
+
+std::string GpuProfiler::FormatResults() const
+{
+    std::string text;
+    char line[128];
+    for (auto&& result : results)
+    {
+        snprintf(line, sizeof(line), "%*s%s: %.2f ms\n", 2 * result.depth, "", result.name.c_str(), result.avgMs);
+        text += line;
+    }
+    if (hasStats)
+    {
+        text += "splats: " + FormatCount(stats.verticesSubmitted) +
+            ", after geometry shader: " + FormatCount(stats.geometryShaderPrimitives) + "\n";
+        text += "clipped primitives: " + FormatCount(stats.clippingInputPrimitives) + " -> " +
+            FormatCount(stats.clippingOutputPrimitives) + "\n";
+        text += "fragments: " + FormatCount(stats.fragmentShaderInvocations) + "\n";
+    }
+    return text;
+}
+
+int64_t GpuProfiler::GetTimestampNs() const
+{
+    GLint64 timestamp = 0;
+    if (supported)
+    {
+#ifdef __ANDROID__
+        glGetInteger64v(GL_TIMESTAMP_EXT, &timestamp);
+#else
+        glGetInteger64v(GL_TIMESTAMP, &timestamp);
+#endif
+    }
+    return (int64_t)timestamp;
+}
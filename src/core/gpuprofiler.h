@@ -0,0 +1,142 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#pragma once
+
+#include <array>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Measures gpu time of named, possibly nested, zones with timestamp queries, and counts the work
+// of the pipeline stages over ranges of draws with pipeline statistics queries. The queries of a
+// frame are read FRAME_LATENCY frames later, a frame whose results are not ready by then is
+// dropped instead of waiting for the gpu. On gles the timestamps need GL_EXT_disjoint_timer_query,
+// a frame the driver flags as disjoint is dropped too, and there are no pipeline statistics.
+class GpuProfiler
+{
+public:
+    static const int FRAME_LATENCY = 3;
+
+    struct ZoneResult
+    {
+        std::string name;
+        int depth;      // nesting level, 0 for the outermost zones
+        double ms;      // of the last completed frame
+        double avgMs;   // exponential moving average, for display
+        int64_t beginNs;    // gpu clock, see GetTimestampNs()
+        int64_t endNs;
+    };
+
+    // summed over every stats range of a frame
+    struct PipelineStats
+    {
+        uint64_t verticesSubmitted = 0;         // one per splat, they are drawn as points
+        uint64_t vertexShaderInvocations = 0;
+        uint64_t geometryShaderInvocations = 0;
+        uint64_t geometryShaderPrimitives = 0;  // splats left after the guard band and alpha culls
+        uint64_t clippingInputPrimitives = 0;
+        uint64_t clippingOutputPrimitives = 0;
+        uint64_t fragmentShaderInvocations = 0;
+    };
+
+    // begins a zone in its constructor and ends it in its destructor, profiler may be null
+    class Zone
+    {
+    public:
+        Zone(GpuProfiler* profilerIn, const char* name);
+        Zone(const Zone& orig) = delete;
+        ~Zone();
+    protected:
+        GpuProfiler* profiler;
+    };
+
+    // same for a stats range
+    class StatsRange
+    {
+    public:
+        StatsRange(GpuProfiler* profilerIn);
+        StatsRange(const StatsRange& orig) = delete;
+        ~StatsRange();
+    protected:
+        GpuProfiler* profiler;
+    };
+
+    GpuProfiler();
+    GpuProfiler(const GpuProfiler& orig) = delete;
+    ~GpuProfiler();
+
+    // returns false if timer queries are not supported
+    bool Init();
+
+    void SetEnabled(bool enabledIn);
+    bool IsEnabled() const { return enabled; }
+
+    // zones are only recorded between these
+    void BeginFrame();
+    void EndFrame();
+
+    // name is kept until the results are read, pass a string literal
+    void BeginZone(const char* name);
+    void EndZone();
+
+    // only one query per statistic can be active, a range begun inside another one is ignored
+    void BeginStats();
+    void EndStats();
+
+    // zones of the last completed frame, in the order they began. The whole frame is the first.
+    const std::vector<ZoneResult>& GetResults() const { return results; }
+    // index of the frame GetResults() belongs to, increments by one per BeginFrame()
+    uint64_t GetResultsFrame() const { return resultsFrame; }
+    // of the same frame, false if it had no stats ranges or they are not supported
+    bool HasPipelineStats() const { return hasStats; }
+    const PipelineStats& GetPipelineStats() const { return stats; }
+    // one line per zone, indented by nesting level, followed by the pipeline stats
+    std::string FormatResults() const;
+
+    // current time of the gpu clock the zones are measured with, to line them up with cpu times
+    int64_t GetTimestampNs() const;
+
+protected:
+    struct PendingZone
+    {
+        const char* name;
+        int depth;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+    struct FrameQueries
+    {
+        std::vector<PendingZone> zones;
+        std::vector<uint32_t> queryPool;
+        size_t queriesUsed = 0;
+        // kept apart from the timestamps, a query object can only be used with one target.
+        // Each stats range takes one query per statistic, always in the same order.
+        std::vector<uint32_t> statsQueryPool;
+        size_t statsQueriesUsed = 0;
+        uint64_t frame = 0;
+        bool pending = false;
+    };
+
+    uint32_t AllocQuery(FrameQueries& fq);
+    void CollectResults(FrameQueries& fq);
+    void CollectStats(FrameQueries& fq);
+
+    bool supported = false;
+    bool statsSupported = false;
+    bool enabled = false;
+    bool inFrame = false;
+    bool inStats = false;
+    uint64_t frame = 0;
+    std::array<FrameQueries, FRAME_LATENCY> frameQueries;
+    std::vector<size_t> zoneStack;  // indices into the zones of the current frame
+
+    std::vector<ZoneResult> results;
+    uint64_t resultsFrame = 0;
+    std::map<std::string, double> avgMap;
+    bool hasStats = false;
+    PipelineStats stats;
+};
@@ -125,6 +125,90 @@ bool Image::Load(const std::string& filenameIn)
     return loaded;
 }
 
+bool Image::Save(const std::string& filenameIn) const
+{
+    const char* filename = filenameIn.c_str();
+
+    int colorType, pixelSize;
+    switch (pixelFormat)
+    {
+    case PixelFormat::R:
+        colorType = PNG_COLOR_TYPE_GRAY;
+        pixelSize = 1;
+        break;
+    case PixelFormat::RA:
+        colorType = PNG_COLOR_TYPE_GA;
+        pixelSize = 2;
+        break;
+    case PixelFormat::RGB:
+        colorType = PNG_COLOR_TYPE_RGB;
+        pixelSize = 3;
+        break;
+    default:
+        colorType = PNG_COLOR_TYPE_RGBA;
+        pixelSize = 4;
+        break;
+    }
+
+    if (data.size() < (size_t)width * height * pixelSize)
+    {
+        Log::E("Image data is too small to save \"%s\"\n", filename);
+        return false;
+    }
+
+#ifdef _WIN32
+    FILE *fp = NULL;
+    fopen_s(&fp, filename, "wb");
+#else
+    FILE *fp = fopen(filename, "wb");
+#endif
+    if (!fp)
+    {
+        Log::E("Failed to open \"%s\" for writing\n", filename);
+        return false;
+    }
+
+    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+    if (!png_ptr || !info_ptr)
+    {
+        Log::E("Failed to create png write struct for \"%s\"\n", filename);
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        fclose(fp);
+        return false;
+    }
+
+    if (setjmp(png_jmpbuf(png_ptr)))
+    {
+        Log::E("Error writing png \"%s\"\n", filename);
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        fclose(fp);
+        return false;
+    }
+
+    png_init_io(png_ptr, fp);
+    png_set_IHDR(png_ptr, info_ptr, width, height, 8, colorType, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    if (isSRGB)
+    {
+        png_set_sRGB_gAMA_and_cHRM(png_ptr, info_ptr, PNG_sRGB_INTENT_PERCEPTUAL);
+    }
+
+    // data is stored bottom row first, see Load()
+    std::vector<png_bytep> rowPointers(height);
+    for (int i = 0; i < (int)height; ++i)
+    {
+        rowPointers[i] = (png_bytep)&data[0] + (height - 1 - i) * width * pixelSize;
+    }
+    png_set_rows(png_ptr, info_ptr, rowPointers.data());
+    png_write_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, NULL);
+
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    fclose(fp);
+
+    return true;
+}
+
 void Image::MultiplyAlpha()
 {
     if (pixelFormat == PixelFormat::R || pixelFormat == PixelFormat::RGB)
@@ -156,3 +240,125 @@ void Image::MultiplyAlpha()
         }
     }
 }
+
+// appends little endian values, which is what OpenEXR stores on disk
+template <typename T>
+static void PushBytes(std::vector<uint8_t>& out, T value)
+{
+    const uint8_t* p = (const uint8_t*)&value;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+static void PushString(std::vector<uint8_t>& out, const char* str)
+{
+    out.insert(out.end(), str, str + strlen(str) + 1);
+}
+
+static void PushAttribHeader(std::vector<uint8_t>& out, const char* name, const char* type, int32_t size)
+{
+    PushString(out, name);
+    PushString(out, type);
+    PushBytes(out, size);
+}
+
+bool SaveEXR(const std::string& filenameIn, uint32_t width, uint32_t height, const std::vector<float>& rgba)
+{
+    const char* filename = filenameIn.c_str();
+    if (rgba.size() < (size_t)width * height * 4)
+    {
+        Log::E("Image data is too small to save \"%s\"\n", filename);
+        return false;
+    }
+
+    // channels must be listed in alphabetical order
+    const char* CHANNEL_NAMES[] = {"A", "B", "G", "R"};
+    const int CHANNEL_OFFSETS[] = {3, 2, 1, 0};
+    const int32_t FLOAT_PIXEL_TYPE = 2;
+
+    std::vector<uint8_t> out;
+    PushBytes(out, (uint32_t)20000630);  // magic number
+    PushBytes(out, (uint32_t)2);  // version 2, single part scanline file
+
+    PushAttribHeader(out, "channels", "chlist", 4 * 18 + 1);
+    for (auto&& name : CHANNEL_NAMES)
+    {
+        PushString(out, name);
+        PushBytes(out, FLOAT_PIXEL_TYPE);
+        PushBytes(out, (uint32_t)0);  // pLinear and reserved
+        PushBytes(out, (int32_t)1);  // xSampling
+        PushBytes(out, (int32_t)1);  // ySampling
+    }
+    out.push_back(0);
+
+    PushAttribHeader(out, "compression", "compression", 1);
+    out.push_back(0);  // NO_COMPRESSION
+
+    const char* WINDOW_NAMES[] = {"dataWindow", "displayWindow"};
+    for (auto&& name : WINDOW_NAMES)
+    {
+        PushAttribHeader(out, name, "box2i", 16);
+        PushBytes(out, (int32_t)0);
+        PushBytes(out, (int32_t)0);
+        PushBytes(out, (int32_t)width - 1);
+        PushBytes(out, (int32_t)height - 1);
+    }
+
+    PushAttribHeader(out, "lineOrder", "lineOrder", 1);
+    out.push_back(0);  // INCREASING_Y
+
+    PushAttribHeader(out, "pixelAspectRatio", "float", 4);
+    PushBytes(out, 1.0f);
+
+    PushAttribHeader(out, "screenWindowCenter", "v2f", 8);
+    PushBytes(out, 0.0f);
+    PushBytes(out, 0.0f);
+
+    PushAttribHeader(out, "screenWindowWidth", "float", 4);
+    PushBytes(out, 1.0f);
+
+    out.push_back(0);  // end of header
+
+    // one scanline per chunk, each is its y, its size, then the channels one after another
+    const uint32_t lineSize = width * 4 * sizeof(float);
+    uint64_t chunkOffset = out.size() + (uint64_t)height * sizeof(uint64_t);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        PushBytes(out, chunkOffset);
+        chunkOffset += 2 * sizeof(int32_t) + lineSize;
+    }
+
+    out.reserve(chunkOffset);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        PushBytes(out, (int32_t)y);
+        PushBytes(out, (int32_t)lineSize);
+        // exr scanlines go top to bottom
+        const float* row = &rgba[(size_t)(height - 1 - y) * width * 4];
+        for (int c = 0; c < 4; c++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                PushBytes(out, row[x * 4 + CHANNEL_OFFSETS[c]]);
+            }
+        }
+    }
+
+#ifdef _WIN32
+    FILE *fp = NULL;
+    fopen_s(&fp, filename, "wb");
+#else
+    FILE *fp = fopen(filename, "wb");
+#endif
+    if (!fp)
+    {
+        Log::E("Failed to open \"%s\" for writing\n", filename);
+        return false;
+    }
+    bool written = fwrite(out.data(), 1, out.size(), fp) == out.size();
+    fclose(fp);
+    if (!written)
+    {
+        Log::E("Error writing exr \"%s\"\n", filename);
+    }
+    return written;
+}
@@ -20,6 +20,8 @@ enum class PixelFormat
 struct Image {
     Image();
     bool Load(const std::string& filename);
+    // writes a png, unlike Load() the filename is not relative to the root path
+    bool Save(const std::string& filename) const;
     void MultiplyAlpha();
 
     uint32_t width;
@@ -28,3 +30,6 @@ struct Image {
     bool isSRGB;
     std::vector<uint8_t> data;
 };
+
+// writes an uncompressed 32 bit float rgba OpenEXR file. rows are bottom to top, as read by glReadPixels
+bool SaveEXR(const std::string& filename, uint32_t width, uint32_t height, const std::vector<float>& rgba);
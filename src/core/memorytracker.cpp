@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "memorytracker.h"
+
+#ifndef __ANDROID__
+#include <GL/glew.h>
+#endif
+
+#include <atomic>
+#include <stdio.h>
+
+namespace
+{
+    struct Counter
+    {
+        std::atomic<size_t> bytes{0};
+        std::atomic<size_t> peakBytes{0};
+    };
+
+    Counter counters[MemoryTracker::NumCategories];
+
+    const char* CATEGORY_NAMES[MemoryTracker::NumCategories] = {
+        "gaussian cloud",
+        "ply",
+        "sort vectors",
+        "buffer objects",
+        "textures"
+    };
+
+    // 1234567 -> "1.18 MB"
+    std::string FormatBytes(size_t bytes)
+    {
+        char str[32];
+        if (bytes >= (size_t)1 << 30)
+        {
+            snprintf(str, sizeof(str), "%.2f GB", (double)bytes / (double)(1 << 30));
+        }
+        else if (bytes >= (size_t)1 << 20)
+        {
+            snprintf(str, sizeof(str), "%.1f MB", (double)bytes / (double)(1 << 20));
+        }
+        else
+        {
+            snprintf(str, sizeof(str), "%.1f KB", (double)bytes / 1024.0);
+        }
+        return str;
+    }
+}
+
+void MemoryTracker::Alloc(Category category, size_t bytes)
+{
+    Counter& counter = counters[category];
+    size_t current = counter.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = counter.peakBytes.load(std::memory_order_relaxed);
+    while (current > peak && !counter.peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+    {
+    }
+}
+
+void MemoryTracker::Free(Category category, size_t bytes)
+{
+    counters[category].bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::GetBytes(Category category)
+{
+    return counters[category].bytes.load(std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::GetPeakBytes(Category category)
+{
+    return counters[category].peakBytes.load(std::memory_order_relaxed);
+}
+
+const char* MemoryTracker::GetName(Category category)
+{
+    return CATEGORY_NAMES[category];
+}
+
+bool MemoryTracker::IsGpu(Category category)
+{
+    return category == BufferObjects || category == Textures;
+}
+
+bool MemoryTracker::QueryVram(size_t& totalBytes, size_t& availableBytes)
+{
+    totalBytes = 0;
+    availableBytes = 0;
+#ifndef __ANDROID__
+    // both report kilobytes
+    if (GLEW_NVX_gpu_memory_info)
+    {
+        GLint totalKb = 0, availableKb = 0;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &totalKb);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &availableKb);
+        totalBytes = (size_t)totalKb * 1024;
+        availableBytes = (size_t)availableKb * 1024;
+        return true;
+    }
+    if (GLEW_ATI_meminfo)
+    {
+        // free memory of the pool, largest free block and the same two for auxiliary memory, no total
+        GLint textureFree[4] = {0, 0, 0, 0};
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, textureFree);
+        availableBytes = (size_t)textureFree[0] * 1024;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string MemoryTracker::FormatReport()
+{
+    std::string text;
+    char line[128];
+    size_t cpuBytes = 0, gpuBytes = 0;
+    for (int i = 0; i < NumCategories; i++)
+    {
+        Category category = (Category)i;
+        size_t bytes = GetBytes(category);
+        (IsGpu(category) ? gpuBytes : cpuBytes) += bytes;
+        snprintf(line, sizeof(line), "%s %s: %s (peak %s)\n", IsGpu(category) ? "gpu" : "cpu", GetName(category),
+                 FormatBytes(bytes).c_str(), FormatBytes(GetPeakBytes(category)).c_str());
+        text += line;
+    }
+    text += "cpu total: " + FormatBytes(cpuBytes) + ", gpu total: " + FormatBytes(gpuBytes) + "\n";
+
+    size_t vramTotal = 0, vramAvailable = 0;
+    if (QueryVram(vramTotal, vramAvailable))
+    {
+        if (vramTotal > 0)
+        {
+            text += "vram: " + FormatBytes(vramTotal - vramAvailable) + " used of " + FormatBytes(vramTotal) + "\n";
+        }
+        else
+        {
+            text += "vram: " + FormatBytes(vramAvailable) + " available\n";
+        }
+    }
+    return text;
+}
@@ -0,0 +1,41 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+// Counts the bytes held by the large allocations of each subsystem, on the cpu and on the gpu, along
+// with the peak of each. Gpu sizes are what was requested from the driver, which may pad or compress
+// them, QueryVram() reports what the driver itself sees where it tells. Safe to call from any thread.
+class MemoryTracker
+{
+public:
+    enum Category
+    {
+        GaussianCloudData = 0,  // cpu copy of the splats
+        PlyData,                // raw vertices of a ply while it is parsed or written
+        SortVectors,            // cpu side positions, indices and keys of the splat renderer
+        BufferObjects,
+        Textures,
+        NumCategories
+    };
+
+    static void Alloc(Category category, size_t bytes);
+    static void Free(Category category, size_t bytes);
+
+    static size_t GetBytes(Category category);
+    static size_t GetPeakBytes(Category category);
+    static const char* GetName(Category category);
+    static bool IsGpu(Category category);
+
+    // total and available video memory from GL_NVX_gpu_memory_info or GL_ATI_meminfo, false if the
+    // driver exposes neither, e.g. on mesa and on Quest. Needs a current context.
+    static bool QueryVram(size_t& totalBytes, size_t& availableBytes);
+
+    // one line per category, then the cpu and gpu totals and the driver's view of video memory
+    static std::string FormatReport();
+};
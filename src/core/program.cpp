@@ -5,7 +5,12 @@
 
 #include "program.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -24,7 +29,9 @@
 #endif
 
 #include "log.h"
+#include "startupreport.h"
 #include "util.h"
+#include "viewuniforms.h"
 
 #ifndef NDEBUG
 #define WARNINGS_AS_ERRORS
@@ -61,14 +68,139 @@ static void DumpShaderSource(const std::string& source)
     Log::D("\n");
 }
 
-static bool CompileShader(GLenum type, const std::string& source, GLint* shaderOut, const std::string& debugName)
+// program binary cache, off while empty
+static std::string binaryCacheDir;
+
+struct BinaryCacheHeader
+{
+    char magic[4];
+    uint32_t keySize;
+    uint32_t format;
+    uint32_t binarySize;
+};
+static const char BINARY_CACHE_MAGIC[4] = {'S', 'P', 'B', '1'};
+
+// part of every cache key, a binary is only handed to the driver that built it
+static const std::string& GetDriverString()
+{
+    static std::string driver;
+    if (driver.empty())
+    {
+        const char* vendor = (const char*)glGetString(GL_VENDOR);
+        const char* renderer = (const char*)glGetString(GL_RENDERER);
+        const char* version = (const char*)glGetString(GL_VERSION);
+        driver = std::string(vendor ? vendor : "") + "\n" + (renderer ? renderer : "") + "\n" +
+                 (version ? version : "") + "\n";
+    }
+    return driver;
+}
+
+static bool IsBinaryCacheEnabled()
+{
+    if (binaryCacheDir.empty())
+    {
+        return false;
+    }
+
+    // some drivers expose the entry points without supporting a single binary format
+    static GLint numFormats = -1;
+    if (numFormats < 0)
+    {
+        numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        if (numFormats == 0)
+        {
+            Log::W("Program binaries are not supported by the driver, shader cache disabled\n");
+        }
+    }
+    return numFormats > 0;
+}
+
+// fnv-1a of the key, the full key is stored in the file and compared on load
+static std::string GetBinaryCacheFilename(const std::string& key)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : key)
+    {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3ull;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+    return GetRootPath() + binaryCacheDir + "/" + name;
+}
+
+// see Program::Uniform<T>
+static uint32_t nextLinkId = 0;
+
+// see Program::SetDeferredLink()
+static bool deferredLink = false;
+static bool parallelShaderCompile = false;
+// programs whose deferred link was not checked yet, see Program::FinishPendingLinks()
+static std::vector<const Program*> pendingPrograms;
+
+static void RemovePendingProgram(const Program* program)
+{
+    auto iter = std::find(pendingPrograms.begin(), pendingPrograms.end(), program);
+    if (iter != pendingPrograms.end())
+    {
+        pendingPrograms.erase(iter);
+    }
+}
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// lets the driver use as many compiler threads as it likes, false if it can't compile in parallel
+static bool EnableParallelShaderCompile()
+{
+#ifdef __ANDROID__
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions; i++)
+    {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, "GL_KHR_parallel_shader_compile") == 0)
+        {
+            using MaxShaderCompilerThreadsFunc = void (*)(GLuint);
+            auto maxShaderCompilerThreads = (MaxShaderCompilerThreadsFunc)eglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+            if (maxShaderCompilerThreads)
+            {
+                maxShaderCompilerThreads(0xffffffff);
+                return true;
+            }
+        }
+    }
+    return false;
+#else
+    if (GLEW_KHR_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsKHR(0xffffffff);
+        return true;
+    }
+    if (GLEW_ARB_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsARB(0xffffffff);
+        return true;
+    }
+    return false;
+#endif
+}
+
+static GLint SubmitShader(GLenum type, const std::string& source)
 {
     GLint shader = glCreateShader(type);
     int size = static_cast<int>(source.size());
     const GLchar* sourcePtr = source.c_str();
     glShaderSource(shader, 1, (const GLchar**)&sourcePtr, &size);
     glCompileShader(shader);
+    return shader;
+}
 
+// logs the errors and warnings of a submitted shader, blocks until it is compiled
+static bool CheckCompileStatus(GLint shader, const std::string& source, const std::string& debugName)
+{
     GLint compiled;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
 
@@ -102,7 +234,6 @@ static bool CompileShader(GLenum type, const std::string& source, GLint* shaderO
         return false;
     }
 
-    *shaderOut = shader;
     return true;
 }
 
@@ -113,6 +244,7 @@ Program::Program() : program(0), vertShader(0), geomShader(0), fragShader(0), co
 #else
     AddMacro("HEADER", "#version 460");
 #endif
+    AddMacro("VIEW_BLOCK", ViewUniforms::GetBlockDeclaration());
 }
 
 Program::~Program()
@@ -120,6 +252,39 @@ Program::~Program()
     Delete();
 }
 
+void Program::SetBinaryCacheDir(const std::string& dir)
+{
+    binaryCacheDir = dir;
+}
+
+void Program::SetDeferredLink(bool deferred)
+{
+    deferredLink = deferred;
+    if (deferred && !parallelShaderCompile)
+    {
+        parallelShaderCompile = EnableParallelShaderCompile();
+        if (!parallelShaderCompile)
+        {
+            Log::D("GL_KHR_parallel_shader_compile not supported, deferred links may still compile serially\n");
+        }
+    }
+}
+
+bool Program::FinishPendingLinks()
+{
+    // FinishLink() removes each program from the list
+    std::vector<const Program*> programs = pendingPrograms;
+    bool result = true;
+    for (auto&& program : programs)
+    {
+        if (!program->FinishLink())
+        {
+            result = false;
+        }
+    }
+    return result;
+}
+
 void Program::AddMacro(const std::string& key, const std::string& value)
 {
     // In order to keep the glsl code compiling if the macro is not applied.
@@ -137,6 +302,7 @@ bool Program::LoadVertGeomFrag(const std::string& vertFilename, const std::strin
 {
     // Delete old shader/program
     Delete();
+    StartupReport::Phase phase("shader compile");
 
     const bool useGeomShader = !geomFilename.empty();
 
@@ -174,89 +340,37 @@ bool Program::LoadVertGeomFrag(const std::string& vertFilename, const std::strin
     }
     fragSource = ExpandMacros(macros, fragSource);
 
-    if (!CompileShader(GL_VERTEX_SHADER, vertSource, &vertShader, vertFilename))
-    {
-        Log::E("Failed to compile vertex shader \"%s\"\n", vertFilename.c_str());
-        return false;
-    }
-
-    if (useGeomShader)
+    std::string cacheKey;
+    if (IsBinaryCacheEnabled())
     {
-        geomSource = ExpandMacros(macros, geomSource);
-        if (!CompileShader(GL_GEOMETRY_SHADER, geomSource, &geomShader, geomFilename))
+        cacheKey = GetDriverString() + vertSource + "\n//geom\n" + geomSource + "\n//frag\n" + fragSource;
+        if (LoadBinary(cacheKey))
         {
-            Log::E("Failed to compile geometry shader \"%s\"\n", geomFilename.c_str());
-            return false;
+            GetActiveVariables();
+            return true;
         }
     }
 
-    if (!CompileShader(GL_FRAGMENT_SHADER, fragSource, &fragShader, fragFilename))
-    {
-        Log::E("Failed to compile fragment shader \"%s\"\n", fragFilename.c_str());
-        return false;
-    }
-
-    program = glCreateProgram();
-    glAttachShader(program, vertShader);
-    glAttachShader(program, fragShader);
+    auto link = std::make_unique<PendingLink>();
+    link->cacheKey = cacheKey;
+    vertShader = SubmitShader(GL_VERTEX_SHADER, vertSource);
+    link->stages.push_back({vertShader, vertFilename, vertSource});
     if (useGeomShader)
     {
-        glAttachShader(program, geomShader);
+        geomShader = SubmitShader(GL_GEOMETRY_SHADER, geomSource);
+        link->stages.push_back({geomShader, geomFilename, geomSource});
     }
-    glLinkProgram(program);
-
-    if (!CheckLinkStatus())
-    {
-        Log::E("Failed to link program \"%s\"\n", debugName.c_str());
+    fragShader = SubmitShader(GL_FRAGMENT_SHADER, fragSource);
+    link->stages.push_back({fragShader, fragFilename, fragSource});
 
-        // dump shader source for reference
-        Log::D("\n");
-        Log::D("%s =\n", vertFilename.c_str());
-        DumpShaderSource(vertSource);
-        if (useGeomShader)
-        {
-            Log::D("%s =\n", geomFilename.c_str());
-            DumpShaderSource(geomSource);
-        }
-        Log::D("%s =\n", fragFilename.c_str());
-        DumpShaderSource(fragSource);
-
-        return false;
-    }
-
-    const int MAX_NAME_SIZE = 1028;
-    static char name[MAX_NAME_SIZE];
-
-    GLint numAttribs;
-    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &numAttribs);
-    for (int i = 0; i < numAttribs; ++i)
-    {
-        Variable v;
-        GLsizei strLen;
-        glGetActiveAttrib(program, i, MAX_NAME_SIZE, &strLen, &v.size, &v.type, name);
-        v.loc = glGetAttribLocation(program, name);
-        attribs[name] = v;
-    }
-
-    GLint numUniforms;
-    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
-    for (int i = 0; i < numUniforms; ++i)
-    {
-        Variable v;
-        GLsizei strLen;
-        glGetActiveUniform(program, i, MAX_NAME_SIZE, &strLen, &v.size, &v.type, name);
-        int loc = glGetUniformLocation(program, name);
-        v.loc = loc;
-        uniforms[name] = v;
-    }
-
-    return true;
+    return Link(std::move(link));
 }
 
 bool Program::LoadCompute(const std::string& computeFilename)
 {
     // Delete old shader/program
     Delete();
+    StartupReport::Phase phase("shader compile");
 
     debugName = computeFilename;
 
@@ -272,61 +386,124 @@ bool Program::LoadCompute(const std::string& computeFilename)
     GL_ERROR_CHECK("Program::LoadCompute LoadFile");
 
     computeSource = ExpandMacros(macros, computeSource);
-    if (!CompileShader(GL_COMPUTE_SHADER, computeSource, &computeShader, computeFilename))
+
+    std::string cacheKey;
+    if (IsBinaryCacheEnabled())
     {
-        Log::E("Failed to compile compute shader \"%s\"\n", computeFilename.c_str());
-        return false;
+        cacheKey = GetDriverString() + computeSource;
+        if (LoadBinary(cacheKey))
+        {
+            GetActiveVariables();
+            return true;
+        }
     }
 
-    GL_ERROR_CHECK("Program::LoadCompute CompileShader");
+    auto link = std::make_unique<PendingLink>();
+    link->cacheKey = cacheKey;
+    computeShader = SubmitShader(GL_COMPUTE_SHADER, computeSource);
+    link->stages.push_back({computeShader, computeFilename, computeSource});
+
+    bool result = Link(std::move(link));
 
+    GL_ERROR_CHECK("Program::LoadCompute Link");
+
+    // TODO: build reflection info on shader storage blocks
+
+    return result;
+}
+
+bool Program::Link(std::unique_ptr<PendingLink> link)
+{
     program = glCreateProgram();
-    glAttachShader(program, computeShader);
+    for (const auto& stage : link->stages)
+    {
+        glAttachShader(program, stage.shader);
+    }
+    if (!link->cacheKey.empty())
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(program);
 
-    GL_ERROR_CHECK("Program::LoadCompute Attach and Link");
+    pendingLink = std::move(link);
+    if (deferredLink)
+    {
+        pendingPrograms.push_back(this);
+        return true;
+    }
+    return FinishLink();
+}
 
-    if (!CheckLinkStatus())
+bool Program::FinishLink() const
+{
+    if (!pendingLink)
+    {
+        return program > 0;
+    }
+    std::unique_ptr<PendingLink> link = std::move(pendingLink);
+    RemovePendingProgram(this);
+    StartupReport::Phase phase("shader link");
+
+    if (parallelShaderCompile)
+    {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed)
+        {
+            Log::D("Waiting for \"%s\" to link\n", debugName.c_str());
+        }
+    }
+
+    bool compiled = true;
+    for (const auto& stage : link->stages)
+    {
+        if (!CheckCompileStatus(stage.shader, stage.source, stage.filename))
+        {
+            Log::E("Failed to compile shader \"%s\"\n", stage.filename.c_str());
+            compiled = false;
+        }
+    }
+
+    if (compiled && !CheckLinkStatus())
     {
         Log::E("Failed to link program \"%s\"\n", debugName.c_str());
 
         // dump shader source for reference
         Log::D("\n");
-        Log::D("%s =\n", computeFilename.c_str());
-        DumpShaderSource(computeSource);
+        for (const auto& stage : link->stages)
+        {
+            Log::D("%s =\n", stage.filename.c_str());
+            DumpShaderSource(stage.source);
+        }
+        compiled = false;
+    }
 
+    if (!compiled)
+    {
+        glDeleteProgram(program);
+        program = 0;
         return false;
     }
 
-    const int MAX_NAME_SIZE = 1028;
-    static char name[MAX_NAME_SIZE];
+    GetActiveVariables();
 
-    GLint numUniforms;
-    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
-    for (int i = 0; i < numUniforms; ++i)
+    if (!link->cacheKey.empty())
     {
-        Variable v;
-        GLsizei strLen;
-        glGetActiveUniform(program, i, MAX_NAME_SIZE, &strLen, &v.size, &v.type, name);
-        int loc = glGetUniformLocation(program, name);
-        v.loc = loc;
-        uniforms[name] = v;
+        SaveBinary(link->cacheKey);
     }
 
-    GL_ERROR_CHECK("Program::LoadCompute get uniforms");
-
-    // TODO: build reflection info on shader storage blocks
-
     return true;
 }
 
 void Program::Bind() const
 {
+    FinishLink();
     glUseProgram(program);
 }
 
 int Program::GetUniformLoc(const std::string& name) const
 {
+    FinishLink();
     auto iter = uniforms.find(name);
     if (iter != uniforms.end())
     {
@@ -340,8 +517,23 @@ int Program::GetUniformLoc(const std::string& name) const
     }
 }
 
+int Program::ResolveUniform(const char* name) const
+{
+    auto iter = uniforms.find(name);
+    if (iter != uniforms.end())
+    {
+        return iter->second.loc;
+    }
+    else
+    {
+        Log::W("Could not find uniform \"%s\" for program \"%s\"\n", name, debugName.c_str());
+        return -1;
+    }
+}
+
 int Program::GetAttribLoc(const std::string& name) const
 {
+    FinishLink();
     auto iter = attribs.find(name);
     if (iter != attribs.end())
     {
@@ -427,6 +619,8 @@ void Program::SetAttribRaw(int loc, glm::vec4* values, size_t stride) const
 void Program::Delete()
 {
     debugName = "";
+    pendingLink.reset();
+    RemovePendingProgram(this);
 
     if (vertShader > 0)
     {
@@ -460,9 +654,10 @@ void Program::Delete()
 
     uniforms.clear();
     attribs.clear();
+    linkId = 0;
 }
 
-bool Program::CheckLinkStatus()
+bool Program::CheckLinkStatus() const
 {
     GLint linked;
     glGetProgramiv(program, GL_LINK_STATUS, &linked);
@@ -496,3 +691,120 @@ bool Program::CheckLinkStatus()
 
     return true;
 }
+
+void Program::GetActiveVariables() const
+{
+    linkId = ++nextLinkId;
+
+    const int MAX_NAME_SIZE = 1028;
+    static char name[MAX_NAME_SIZE];
+
+    GLint numAttribs;
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &numAttribs);
+    for (int i = 0; i < numAttribs; ++i)
+    {
+        Variable v;
+        GLsizei strLen;
+        glGetActiveAttrib(program, i, MAX_NAME_SIZE, &strLen, &v.size, &v.type, name);
+        v.loc = glGetAttribLocation(program, name);
+        attribs[name] = v;
+    }
+
+    GLint numUniforms;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
+    for (int i = 0; i < numUniforms; ++i)
+    {
+        Variable v;
+        GLsizei strLen;
+        glGetActiveUniform(program, i, MAX_NAME_SIZE, &strLen, &v.size, &v.type, name);
+        int loc = glGetUniformLocation(program, name);
+        v.loc = loc;
+        uniforms[name] = v;
+    }
+}
+
+bool Program::LoadBinary(const std::string& key)
+{
+    std::ifstream ifs(GetBinaryCacheFilename(key), std::ifstream::in | std::ifstream::binary);
+    if (!ifs.good())
+    {
+        return false;
+    }
+
+    BinaryCacheHeader header;
+    if (!ifs.read((char*)&header, sizeof(header)) ||
+        memcmp(header.magic, BINARY_CACHE_MAGIC, sizeof(BINARY_CACHE_MAGIC)) != 0 ||
+        header.keySize != key.size())
+    {
+        return false;
+    }
+    std::string fileKey(header.keySize, '\0');
+    std::vector<char> binary(header.binarySize);
+    if (!ifs.read(&fileKey[0], header.keySize) || fileKey != key ||
+        !ifs.read(binary.data(), header.binarySize))
+    {
+        return false;
+    }
+
+    program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        // e.g. a driver update that kept the version string, compile from source and replace it
+        Log::D("Program binary rejected for \"%s\"\n", debugName.c_str());
+        glDeleteProgram(program);
+        program = 0;
+        // an unknown format is reported as GL_INVALID_ENUM, it is handled here
+        while (glGetError() != GL_NO_ERROR) {}
+        return false;
+    }
+
+    Log::D("Loaded program binary for \"%s\"\n", debugName.c_str());
+    return true;
+}
+
+void Program::SaveBinary(const std::string& key) const
+{
+    GLint binarySize = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if (binarySize <= 0)
+    {
+        return;
+    }
+    std::vector<char> binary(binarySize);
+    GLenum format = 0;
+    GLsizei len = 0;
+    glGetProgramBinary(program, binarySize, &len, &format, binary.data());
+
+    BinaryCacheHeader header;
+    memcpy(header.magic, BINARY_CACHE_MAGIC, sizeof(BINARY_CACHE_MAGIC));
+    header.keySize = (uint32_t)key.size();
+    header.format = (uint32_t)format;
+    header.binarySize = (uint32_t)len;
+
+    std::error_code ec;
+    std::filesystem::create_directories(GetRootPath() + binaryCacheDir, ec);
+
+    // written under a temporary name, so another instance never loads a partial file
+    std::string filename = GetBinaryCacheFilename(key);
+    std::string tempFilename = filename + ".tmp";
+    {
+        std::ofstream ofs(tempFilename, std::ofstream::out | std::ofstream::binary);
+        ofs.write((const char*)&header, sizeof(header));
+        ofs.write(key.data(), key.size());
+        ofs.write(binary.data(), len);
+        if (!ofs.good())
+        {
+            Log::W("Failed to write program binary \"%s\"\n", tempFilename.c_str());
+            return;
+        }
+    }
+    std::filesystem::rename(tempFilename, filename, ec);
+    if (ec)
+    {
+        Log::W("Failed to write program binary \"%s\"\n", filename.c_str());
+    }
+}
@@ -7,6 +7,7 @@
 
 #include <glm/glm.hpp>
 #include <iostream>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -18,6 +19,20 @@ public:
     Program();
     ~Program();
 
+    // linked programs are cached as driver binaries in dir (relative to the root path), keyed by
+    // the expanded shader sources and the driver. A binary the driver rejects is recompiled and
+    // replaced. An empty dir disables the cache.
+    static void SetBinaryCacheDir(const std::string& dir);
+
+    // while enabled the Load functions only submit the compile and link and return, the driver
+    // builds the programs in parallel (GL_KHR_parallel_shader_compile) and the first Bind() or
+    // lookup waits for the result. Compile and link errors are logged then and leave the
+    // program unusable, so turn it off again once the startup programs are submitted and check
+    // them with FinishPendingLinks().
+    static void SetDeferredLink(bool deferred);
+    // waits for every deferred link that has not been used yet, false if any of them failed
+    static bool FinishPendingLinks();
+
     // used to inject #defines or other code into shaders
     // AddMacro("FOO", "BAR");
     // will replace the string /*%%FOO%%*/ in the source shader with BAR
@@ -31,9 +46,41 @@ public:
     int GetUniformLoc(const std::string& name) const;
     int GetAttribLoc(const std::string& name) const;
 
+    // uniform location that is looked up once instead of on every SetUniform(name, value),
+    // for uniforms set per draw. Resolved on first use and again after the program is reloaded,
+    // so keep one per program it is used with.
+    template <typename T>
+    class Uniform
+    {
+    public:
+        using ValueType = T;
+        explicit Uniform(const char* nameIn) : name(nameIn) {}
+    private:
+        friend class Program;
+        const char* name;
+        mutable int loc = -1;
+        mutable uint32_t linkId = 0;
+    };
+
+    template <typename T>
+    void SetUniform(const Uniform<T>& uniform, const typename Uniform<T>::ValueType& value) const
+    {
+        FinishLink();
+        if (uniform.linkId != linkId)
+        {
+            uniform.loc = ResolveUniform(uniform.name);
+            uniform.linkId = linkId;
+        }
+        if (uniform.loc >= 0)
+        {
+            SetUniformRaw(uniform.loc, value);
+        }
+    }
+
     template <typename T>
     void SetUniform(const std::string& name, T value) const
     {
+        FinishLink();
         auto iter = uniforms.find(name);
         if (iter != uniforms.end())
         {
@@ -58,6 +105,7 @@ public:
     template <typename T>
     void SetAttrib(const std::string& name, T* values, size_t stride = 0) const
     {
+        FinishLink();
         auto iter = attribs.find(name);
         if (iter != attribs.end())
         {
@@ -76,10 +124,36 @@ public:
 
 protected:
 
-    void Delete();
-    bool CheckLinkStatus();
+    // shaders that were submitted to the driver but not checked yet
+    struct PendingLink
+    {
+        struct Stage
+        {
+            int shader;
+            std::string filename;
+            std::string source;
+        };
+        std::vector<Stage> stages;
+        std::string cacheKey;
+    };
 
-    int program;
+    void Delete();
+    bool Link(std::unique_ptr<PendingLink> link);
+    // checks the results of Link(), blocks until the driver is done, deferred links end up here on first use
+    bool FinishLink() const;
+    bool CheckLinkStatus() const;
+    void GetActiveVariables() const;
+    // location for Uniform<T>, -1 and a warning if the program has no such uniform
+    int ResolveUniform(const char* name) const;
+    // key is the driver and the expanded sources, program is only created on success
+    bool LoadBinary(const std::string& key);
+    void SaveBinary(const std::string& key) const;
+
+    // filled in lazily when a deferred link finishes
+    mutable int program;
+    mutable std::unique_ptr<PendingLink> pendingLink;
+    // unique per successful link, tells Uniform<T> handles when to look up their location again
+    mutable uint32_t linkId = 0;
     int vertShader;
     int geomShader;
     int fragShader;
@@ -92,8 +166,8 @@ protected:
         int loc;
     };
 
-    std::unordered_map<std::string, Variable> uniforms;
-    std::unordered_map<std::string, Variable> attribs;
+    mutable std::unordered_map<std::string, Variable> uniforms;
+    mutable std::unordered_map<std::string, Variable> attribs;
     std::vector<std::pair<std::string, std::string>> macros;
     std::string debugName;
 };
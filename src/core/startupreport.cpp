@@ -0,0 +1,120 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "startupreport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "memorytracker.h"
+#include "traceprofiler.h"
+
+namespace
+{
+    struct PhaseTotal
+    {
+        const char* name;
+        const char* threadName;  // nullptr on the main thread
+        int64_t firstBeginNs;
+        int64_t totalNs;
+        int count;
+    };
+
+    std::atomic<bool> recording(false);
+    std::mutex phaseMutex;
+    std::vector<PhaseTotal> phaseVec;
+    int64_t startupBeginNs = 0;
+    int64_t startupEndNs = 0;
+    thread_local const char* threadName = nullptr;
+}
+
+StartupReport::Phase::Phase(const char* nameIn) : name(nameIn), beginNs(IsRecording() ? TraceProfiler::NowNs() : -1)
+{
+}
+
+StartupReport::Phase::~Phase()
+{
+    if (beginNs < 0 || !IsRecording())
+    {
+        return;
+    }
+
+    int64_t durationNs = TraceProfiler::NowNs() - beginNs;
+    std::lock_guard<std::mutex> lock(phaseMutex);
+    for (auto&& phase : phaseVec)
+    {
+        if (strcmp(phase.name, name) == 0 && phase.threadName == threadName)
+        {
+            phase.totalNs += durationNs;
+            phase.count++;
+            return;
+        }
+    }
+    phaseVec.push_back({name, threadName, beginNs, durationNs, 1});
+}
+
+void StartupReport::SetThreadName(const char* name)
+{
+    threadName = name;
+}
+
+void StartupReport::Begin()
+{
+    std::lock_guard<std::mutex> lock(phaseMutex);
+    phaseVec.clear();
+    startupBeginNs = TraceProfiler::NowNs();
+    startupEndNs = startupBeginNs;
+    recording.store(true, std::memory_order_relaxed);
+}
+
+void StartupReport::End()
+{
+    recording.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(phaseMutex);
+    startupEndNs = TraceProfiler::NowNs();
+}
+
+bool StartupReport::IsRecording()
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+std::string StartupReport::FormatReport()
+{
+    std::string text;
+    char line[160];
+    {
+        std::lock_guard<std::mutex> lock(phaseMutex);
+        std::vector<PhaseTotal> sortedVec = phaseVec;
+        std::sort(sortedVec.begin(), sortedVec.end(), [](const PhaseTotal& a, const PhaseTotal& b)
+        {
+            return a.firstBeginNs < b.firstBeginNs;
+        });
+
+        snprintf(line, sizeof(line), "startup: %.1f ms\n", (double)(startupEndNs - startupBeginNs) / 1e6);
+        text += line;
+        for (auto&& phase : sortedVec)
+        {
+            snprintf(line, sizeof(line), "  %s: %.1f ms", phase.name, (double)phase.totalNs / 1e6);
+            text += line;
+            if (phase.count > 1)
+            {
+                text += " (" + std::to_string(phase.count) + " times)";
+            }
+            if (phase.threadName)
+            {
+                // overlaps the phases of the main thread
+                text += std::string(", on ") + phase.threadName;
+            }
+            text += "\n";
+        }
+    }
+    text += MemoryTracker::FormatReport();
+    return text;
+}
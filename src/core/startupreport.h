@@ -0,0 +1,39 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+// Wall time of the phases of startup: gl init, ply parsing and conversion, shader compiles and links,
+// buffer uploads. Phases with the same name add up, e.g. every shader compile, and phases on other
+// threads are listed with the thread they ran on, they overlap the main thread. Nested phases also
+// count towards the phase around them. Only phases between
+// Begin() and End() are recorded, so runtime work such as switching render modes is left out.
+class StartupReport
+{
+public:
+    // records the time between its constructor and destructor, name must be a string literal
+    class Phase
+    {
+    public:
+        Phase(const char* nameIn);
+        Phase(const Phase& orig) = delete;
+        ~Phase();
+    protected:
+        const char* name;
+        int64_t beginNs;
+    };
+
+    // called by worker threads, their phases are listed with this name. Must be a string literal.
+    static void SetThreadName(const char* name);
+    static void Begin();
+    static void End();
+    static bool IsRecording();
+
+    // every phase in the order it started, followed by the memory of each subsystem
+    static std::string FormatReport();
+};
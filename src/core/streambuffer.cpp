@@ -0,0 +1,161 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "streambuffer.h"
+
+#ifdef __ANDROID__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES3/gl3ext.h>
+#else
+#include <GL/glew.h>
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL2/SDL_opengl.h>
+#include <SDL2/SDL_opengl_glext.h>
+#endif
+
+#include "log.h"
+#include "util.h"
+
+// keeps every allocation aligned for any vertex attribute type
+static const size_t STREAM_ALIGNMENT = 16;
+// one second, the gpu is hung if a frame takes longer
+static const GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+StreamBuffer::StreamBuffer(size_t regionSizeIn) : regionSize(regionSizeIn)
+{
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (auto&& fence : fences)
+    {
+        if (fence)
+        {
+            glDeleteSync((GLsync)fence);
+        }
+    }
+    if (obj)
+    {
+        if (persistent)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, obj);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &obj);
+    }
+}
+
+bool StreamBuffer::Init()
+{
+    const size_t totalSize = regionSize * NUM_REGIONS;
+    glGenBuffers(1, &obj);
+    glBindBuffer(GL_ARRAY_BUFFER, obj);
+
+#ifndef __ANDROID__
+    if (GLEW_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+        persistentPtr = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags);
+        persistent = persistentPtr != nullptr;
+        if (!persistent)
+        {
+            Log::E("StreamBuffer could not be mapped persistently\n");
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            return false;
+        }
+    }
+#endif
+    if (!persistent)
+    {
+        // regions are mapped unsynchronized one write at a time, the fences still apply
+        glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GL_ERROR_CHECK("StreamBuffer::Init()");
+
+    return true;
+}
+
+void* StreamBuffer::Map(size_t size, size_t* offsetOut)
+{
+    const int region = (int)(frame % NUM_REGIONS);
+    if (!regionReady)
+    {
+        WaitForRegion(region);
+        regionUsed = 0;
+        regionReady = true;
+    }
+
+    size_t alignedSize = (size + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+    if (regionUsed + alignedSize > regionSize)
+    {
+        if (!warnedFull)
+        {
+            Log::W("StreamBuffer region of %zu bytes is full, geometry dropped\n", regionSize);
+            warnedFull = true;
+        }
+        return nullptr;
+    }
+
+    size_t offset = region * regionSize + regionUsed;
+    regionUsed += alignedSize;
+    *offsetOut = offset;
+
+    if (persistent)
+    {
+        return persistentPtr + offset;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, obj);
+    void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    mapped = ptr != nullptr;
+    return ptr;
+}
+
+void StreamBuffer::Unmap()
+{
+    if (mapped)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, obj);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        mapped = false;
+    }
+}
+
+void StreamBuffer::EndFrame()
+{
+    if (regionReady)
+    {
+        const int region = (int)(frame % NUM_REGIONS);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        regionReady = false;
+    }
+    frame++;
+}
+
+void StreamBuffer::WaitForRegion(int region)
+{
+    GLsync fence = (GLsync)fences[region];
+    if (!fence)
+    {
+        return;
+    }
+
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+    if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+    {
+        Log::W("StreamBuffer fence wait failed\n");
+    }
+    glDeleteSync(fence);
+    fences[region] = nullptr;
+}
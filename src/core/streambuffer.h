@@ -0,0 +1,53 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+// Vertex buffer for geometry that is rebuilt every frame, shared by the overlay renderers.
+// It is split into one region per frame in flight, each frame writes into its own region and
+// a fence keeps the cpu from overwriting a region the gpu may still be drawing from.
+// Persistently mapped where GL_ARB_buffer_storage is available, mapped per write otherwise.
+class StreamBuffer
+{
+public:
+    static const int NUM_REGIONS = 3;
+
+    // regionSizeIn bytes per frame
+    StreamBuffer(size_t regionSizeIn);
+    StreamBuffer(const StreamBuffer& orig) = delete;
+    ~StreamBuffer();
+
+    bool Init();
+
+    // size bytes of this frame's region for the caller to fill, their offset into the buffer
+    // goes to offsetOut. Returns nullptr if the region is full. Call Unmap() before drawing.
+    void* Map(size_t size, size_t* offsetOut);
+    void Unmap();
+
+    // call once every draw that reads this frame's data is submitted
+    void EndFrame();
+
+    // incremented by EndFrame(), lets renderers drawn more than once a frame upload only once
+    uint64_t GetFrame() const { return frame; }
+    uint32_t GetObj() const { return obj; }
+
+protected:
+    void WaitForRegion(int region);
+
+    size_t regionSize;
+    uint32_t obj = 0;
+    bool persistent = false;
+    uint8_t* persistentPtr = nullptr;
+    bool mapped = false;
+    std::array<void*, NUM_REGIONS> fences = {};  // GLsync
+    uint64_t frame = 0;
+    size_t regionUsed = 0;
+    bool regionReady = false;
+    bool warnedFull = false;
+};
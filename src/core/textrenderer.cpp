@@ -5,6 +5,7 @@
 
 #include "textrenderer.h"
 
+#include <cstddef>
 #include <fstream>
 
 #ifdef __ANDROID__
@@ -23,6 +24,7 @@
 #include "core/log.h"
 #include "core/util.h"
 #include "core/program.h"
+#include "core/streambuffer.h"
 #include "core/texture.h"
 
 const int TAB_SIZE = 4;
@@ -33,8 +35,19 @@ TextRenderer::TextRenderer()
 
 }
 
-bool TextRenderer::Init(const std::string& fontJsonFilename, const std::string& fontPngFilename)
+TextRenderer::~TextRenderer()
 {
+    if (vao)
+    {
+        glDeleteVertexArrays(1, &vao);
+    }
+}
+
+bool TextRenderer::Init(const std::string& fontJsonFilename, const std::string& fontPngFilename,
+                        std::shared_ptr<StreamBuffer> streamBufferIn)
+{
+    streamBuffer = streamBufferIn;
+
     std::ifstream f(GetRootPath() + fontJsonFilename);
     if (f.fail())
     {
@@ -105,38 +118,96 @@ bool TextRenderer::Init(const std::string& fontJsonFilename, const std::string&
         return false;
     }
 
+    glGenVertexArrays(1, &vao);
+
     return true;
 }
 
 void TextRenderer::Render(const glm::mat4& cameraMat, const glm::mat4& projMat,
                           const glm::vec4& viewport, const glm::vec2& nearFar)
 {
+    // every view of a frame draws the same glyphs, only the first one uploads them
+    if (uploadFrame != streamBuffer->GetFrame())
+    {
+        uploadFrame = streamBuffer->GetFrame();
+        Upload();
+    }
+
+    if (screenVertexCount + worldVertexCount == 0)
+    {
+        return;
+    }
+
     textProg->Bind();
 
     // use texture unit 0 for fontTexture
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, fontTex->texture);
-    textProg->SetUniform("fontTex", 0);
+    textProg->SetUniform(fontTexUniform, 0);
+
+    // with a buffer bound the attrib pointers are offsets into it
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, streamBuffer->GetObj());
+    const uint8_t* base = (const uint8_t*)uploadOffset;
+    textProg->SetAttrib("position", (glm::vec3*)(base + offsetof(Vertex, position)), sizeof(Vertex));
+    textProg->SetAttrib("uv", (glm::vec2*)(base + offsetof(Vertex, uv)), sizeof(Vertex));
+    textProg->SetAttrib("color", (glm::vec4*)(base + offsetof(Vertex, color)), sizeof(Vertex));
+
+    // one draw for all screen aligned texts and one for all world texts
+    if (screenVertexCount > 0)
+    {
+        float aspect = viewport.w / viewport.z;
+        glm::mat4 aspectMat = MakeMat4(glm::vec3(aspect, 1.0f, 1.0f), glm::quat(), glm::vec3(-aspect / aspect, 0.0f, 0.0f));
+        textProg->SetUniform(modelViewProjMatUniform, aspectMat);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)screenVertexCount);
+    }
+    if (worldVertexCount > 0)
+    {
+        glm::mat4 viewProjMat = projMat * glm::inverse(cameraMat);
+        textProg->SetUniform(modelViewProjMatUniform, viewProjMat);
+        glDrawArrays(GL_TRIANGLES, (GLint)screenVertexCount, (GLsizei)worldVertexCount);
+    }
 
-    glm::mat4 viewProjMat = projMat * glm::inverse(cameraMat);
-    float aspect = viewport.w / viewport.z;
-    glm::mat4 aspectMat = MakeMat4(glm::vec3(aspect, 1.0f, 1.0f), glm::quat(), glm::vec3(-aspect / aspect, 0.0f, 0.0f));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void TextRenderer::Upload()
+{
+    screenVertexCount = 0;
+    worldVertexCount = 0;
     for (auto&& tIter : textMap)
     {
-        if (tIter.second.isScreenAligned)
-        {
-            textProg->SetUniform("modelViewProjMat", aspectMat * tIter.second.xform);
-        }
-        else
+        size_t& count = tIter.second.isScreenAligned ? screenVertexCount : worldVertexCount;
+        count += tIter.second.posVec.size();
+    }
+
+    size_t numVertices = screenVertexCount + worldVertexCount;
+    Vertex* vertices = numVertices > 0 ? (Vertex*)streamBuffer->Map(numVertices * sizeof(Vertex), &uploadOffset) : nullptr;
+    if (!vertices)
+    {
+        screenVertexCount = 0;
+        worldVertexCount = 0;
+        return;
+    }
+
+    // writes go straight into mapped gpu memory, keep them sequential
+    Vertex* screenDst = vertices;
+    Vertex* worldDst = vertices + screenVertexCount;
+    for (auto&& tIter : textMap)
+    {
+        const Text& text = tIter.second;
+        Vertex*& dst = text.isScreenAligned ? screenDst : worldDst;
+        for (size_t i = 0; i < text.posVec.size(); i++)
         {
-            textProg->SetUniform("modelViewProjMat", viewProjMat * tIter.second.xform);
+            dst->position = glm::vec3(text.xform * glm::vec4(text.posVec[i], 1.0f));
+            dst->uv = text.uvVec[i];
+            dst->color = text.colorVec[i];
+            dst++;
         }
-        textProg->SetAttrib("position", tIter.second.posVec.data());
-        textProg->SetAttrib("uv", tIter.second.uvVec.data());
-        textProg->SetAttrib("color", tIter.second.colorVec.data());
-
-        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)tIter.second.posVec.size());
     }
+
+    streamBuffer->Unmap();
 }
 
 // creates a new text and adds it to the scene
@@ -149,9 +220,11 @@ TextRenderer::TextKey TextRenderer::AddWorldText(const glm::mat4 xform, const gl
     text.uvVec.reserve(asciiString.size() * 6);
     text.colorVec.reserve(asciiString.size() * 6);
     text.isScreenAligned = false;
+    text.lineHeight = lineHeight;
+    text.color = color;
+    text.addDropShadow = false;
 
-    glm::vec3 pen(0.0f, 0.0f, 0.0f);
-    BuildText(text, pen, lineHeight, color, asciiString);
+    RebuildText(text, asciiString);
 
     uint32_t textKey = nextKey++;
     textMap.insert(std::pair<uint32_t, Text>(textKey, text));
@@ -182,6 +255,15 @@ void TextRenderer::SetTextXform(TextKey key, const glm::mat4 xform)
     }
 }
 
+void TextRenderer::SetText(TextKey key, const std::string& asciiString)
+{
+    auto tIter = textMap.find(key);
+    if (tIter != textMap.end())
+    {
+        RebuildText(tIter->second, asciiString);
+    }
+}
+
 // removes text object form the scene
 void TextRenderer::RemoveText(TextKey key)
 {
@@ -245,6 +327,22 @@ void TextRenderer::BuildText(Text& text, const glm::vec3& pen, float lineHeight,
     }
 }
 
+void TextRenderer::RebuildText(Text& text, const std::string& asciiString) const
+{
+    text.posVec.clear();
+    text.uvVec.clear();
+    text.colorVec.clear();
+
+    if (text.addDropShadow)
+    {
+        glm::vec3 shadowPen = glm::vec3(0.05f * text.lineHeight, -0.05f * text.lineHeight, 0.1f);
+        BuildText(text, shadowPen, text.lineHeight, text.shadowColor, asciiString);
+    }
+
+    glm::vec3 pen(0.0f, 0.0f, 0.0f);
+    BuildText(text, pen, text.lineHeight, text.color, asciiString);
+}
+
 TextRenderer::TextKey TextRenderer::AddScreenTextImpl(const glm::ivec2& pos, int numRows, const glm::vec4& color,
                                                       const std::string& asciiString, bool addDropShadow,
                                                       const glm::vec4& shadowColor)
@@ -259,15 +357,12 @@ TextRenderer::TextKey TextRenderer::AddScreenTextImpl(const glm::ivec2& pos, int
     text.uvVec.reserve(vecSize);
     text.colorVec.reserve(vecSize);
     text.isScreenAligned = true;
+    text.lineHeight = TEXT_LINE_HEIGHT;
+    text.color = color;
+    text.addDropShadow = addDropShadow;
+    text.shadowColor = shadowColor;
 
-    if (addDropShadow)
-    {
-        glm::vec3 shadowPen = glm::vec3(0.05f * TEXT_LINE_HEIGHT, -0.05f * TEXT_LINE_HEIGHT, 0.1f);
-        BuildText(text, shadowPen, TEXT_LINE_HEIGHT, shadowColor, asciiString);
-    }
-
-    glm::vec3 pen(0.0f, 0.0f, 0.0f);
-    BuildText(text, pen, TEXT_LINE_HEIGHT, color, asciiString);
+    RebuildText(text, asciiString);
 
     uint32_t textKey = nextKey++;
     textMap.insert(std::pair<uint32_t, Text>(textKey, text));
@@ -8,11 +8,14 @@
 #include <array>
 #include <glm/glm.hpp>
 #include <memory>
+#include <stdint.h>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
-class Program;
+#include "program.h"
+
+class StreamBuffer;
 struct Texture;
 
 class TextRenderer
@@ -20,8 +23,11 @@ class TextRenderer
 public:
 
 	TextRenderer();
+	~TextRenderer();
 
-	bool Init(const std::string& fontJsonFilename, const std::string& fontPngFilename);
+	// the glyphs of all texts are written into streamBufferIn, once per frame
+	bool Init(const std::string& fontJsonFilename, const std::string& fontPngFilename,
+	          std::shared_ptr<StreamBuffer> streamBufferIn);
 
 	// viewport = (x, y, width, height)
 	void Render(const glm::mat4& cameraMat, const glm::mat4& projMat,
@@ -37,6 +43,8 @@ public:
     TextKey AddScreenTextWithDropShadow(const glm::ivec2& pos, int numRows, const glm::vec4& color,
                                         const glm::vec4& shadowColor, const std::string& asciiString);
     void SetTextXform(TextKey key, const glm::mat4 xform);
+    // replaces the string of an existing text, keeping its position, size and colors
+    void SetText(TextKey key, const std::string& asciiString);
 
     // removes text object form the scene
     void RemoveText(TextKey key);
@@ -59,19 +67,44 @@ protected:
         std::vector<glm::vec2> uvVec;
         std::vector<glm::vec4> colorVec;
         bool isScreenAligned;
+        // kept for SetText()
+        float lineHeight;
+        glm::vec4 color;
+        bool addDropShadow;
+        glm::vec4 shadowColor;
+    };
+
+    // interleaved in the stream buffer, positions have the text xform applied
+    struct Vertex
+    {
+        glm::vec3 position;
+        glm::vec2 uv;
+        glm::vec4 color;
     };
 
     void BuildText(Text& text, const glm::vec3& pen, float lineHeight, const glm::vec4& color,
                    const std::string& asciiString) const;
+    // clears the glyphs of text, the vectors keep their capacity, and builds asciiString
+    void RebuildText(Text& text, const std::string& asciiString) const;
+    void Upload();
     TextKey AddScreenTextImpl(const glm::ivec2& pos, int numRows, const glm::vec4& color,
                               const std::string& asciiString, bool addDropShadow, const glm::vec4& shadowColor);
 
     std::unordered_map<uint8_t, Glyph> glyphMap;
     float textureWidth;
     std::shared_ptr<Program> textProg;
+    Program::Uniform<glm::mat4> modelViewProjMatUniform{"modelViewProjMat"};
+    Program::Uniform<int32_t> fontTexUniform{"fontTex"};
     std::shared_ptr<Texture> fontTex;
     std::unordered_map<uint32_t, Text> textMap;
     Glyph spaceGlyph;
+
+    std::shared_ptr<StreamBuffer> streamBuffer;
+    uint32_t vao = 0;
+    uint64_t uploadFrame = UINT64_MAX;  // stream buffer frame the glyphs were last written in
+    size_t uploadOffset = 0;
+    size_t screenVertexCount = 0;  // screen aligned texts first, then world texts
+    size_t worldVertexCount = 0;
 };
 
 
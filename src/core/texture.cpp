@@ -18,6 +18,7 @@
 #endif
 
 #include "core/image.h"
+#include "core/memorytracker.h"
 
 static GLenum filterTypeToGL[] = {
     GL_NEAREST,
@@ -44,6 +45,38 @@ static GLenum pixelFormatToGL[] = {
     GL_RGBA
 };
 
+// what the driver most likely allocates, three component formats are padded to four
+static size_t BytesPerTexel(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_R8:
+    case GL_LUMINANCE:
+        return 1;
+    case GL_LUMINANCE_ALPHA:
+        return 2;
+    case GL_RGB:
+    case GL_RGBA:
+    case GL_RGBA8:
+    case GL_SRGB8:
+    case GL_SRGB8_ALPHA8:
+    case GL_R32F:
+    case GL_R32UI:
+    case GL_R11F_G11F_B10F:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+        return 4;
+    case GL_RGB16F:
+    case GL_RGBA16F:
+    case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
 Texture::Texture(const Image& image, const Params& params)
 {
     glGenTextures(1, &texture);
@@ -71,10 +104,14 @@ Texture::Texture(const Image& image, const Params& params)
 
     glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, pf, GL_UNSIGNED_BYTE, &image.data[0]);
 
+    byteSize = (size_t)image.width * image.height * BytesPerTexel(internalFormat);
     if ((int)params.minFilter >= (int)FilterType::NearestMipmapNearest)
     {
         glGenerateMipmap(GL_TEXTURE_2D);
+        // the mip chain adds a third
+        byteSize += byteSize / 3;
     }
+    MemoryTracker::Alloc(MemoryTracker::Textures, byteSize);
 
     if (image.pixelFormat == PixelFormat::RA || image.pixelFormat == PixelFormat::RGBA)
     {
@@ -94,11 +131,15 @@ Texture::Texture(uint32_t width, uint32_t height, uint32_t internalFormat,
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapTypeToGL[(int)params.tWrap]);
 
     glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+
+    byteSize = (size_t)width * height * BytesPerTexel(internalFormat);
+    MemoryTracker::Alloc(MemoryTracker::Textures, byteSize);
 }
 
 Texture::~Texture()
 {
     glDeleteTextures(1, &texture);
+    MemoryTracker::Free(MemoryTracker::Textures, byteSize);
 }
 
 void Texture::Bind(int unit) const
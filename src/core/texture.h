@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 struct Image;
@@ -47,4 +48,5 @@ struct Texture
 
     uint32_t texture;
     bool hasAlphaChannel;
+    size_t byteSize;  // estimated, for the memory report
 };
@@ -0,0 +1,269 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "traceprofiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <vector>
+
+#include "gpuprofiler.h"
+#include "log.h"
+
+// zones per thread, a capture with more than this loses the oldest ones
+static const uint64_t RING_SIZE = 1 << 15;
+
+// gpu zones of a frame arrive this many frames after it ended
+static const uint64_t GPU_FRAME_LATENCY = GpuProfiler::FRAME_LATENCY + 1;
+
+// chrome trace process ids
+static const int CPU_PID = 0;
+static const int GPU_PID = 1;
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        int64_t beginNs;
+        int64_t endNs;
+    };
+
+    struct ThreadBuffer
+    {
+        uint32_t tid;
+        const char* name;
+        std::vector<Event> ring;
+        // only the owning thread writes, events below writeIndex - RING_SIZE are overwritten
+        std::atomic<uint64_t> writeIndex;
+    };
+
+    struct GpuEvent
+    {
+        std::string name;
+        int64_t beginNs;
+        int64_t endNs;
+    };
+
+    // buffers are never freed, so the zones of a thread that exited are still written
+    std::mutex threadBufferMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threadBufferVec;
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+    thread_local const char* threadName = nullptr;
+
+    // only touched by the thread calling EndFrame()
+    struct CaptureState
+    {
+        bool pending = false;
+        std::string filename;
+        uint64_t firstFrame = 0;
+        uint64_t endFrame = 0;
+        int64_t beginNs = 0;
+        int64_t endNs = 0;
+        std::vector<GpuEvent> gpuEventVec;
+    };
+    CaptureState capture;
+    uint64_t frame = 0;
+    int64_t frameBeginNs = 0;
+
+    ThreadBuffer* GetThreadBuffer()
+    {
+        if (!threadBuffer)
+        {
+            std::lock_guard<std::mutex> lock(threadBufferMutex);
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->tid = (uint32_t)threadBufferVec.size() + 1;
+            buffer->name = threadName;
+            buffer->ring.resize(RING_SIZE);
+            buffer->writeIndex.store(0, std::memory_order_relaxed);
+            threadBuffer = buffer.get();
+            threadBufferVec.push_back(std::move(buffer));
+        }
+        return threadBuffer;
+    }
+
+    bool WriteTrace()
+    {
+        std::ofstream ofs(capture.filename, std::ofstream::out);
+        if (!ofs.good())
+        {
+            Log::E("Could not open trace \"%s\"\n", capture.filename.c_str());
+            return false;
+        }
+
+        auto overlaps = [](int64_t beginNs, int64_t endNs)
+        {
+            return endNs >= capture.beginNs && beginNs <= capture.endNs;
+        };
+        // microseconds since the start of the capture
+        auto toUs = [](int64_t ns)
+        {
+            return (double)(ns - capture.beginNs) / 1000.0;
+        };
+
+        nlohmann::json events = nlohmann::json::array();
+        events.push_back({{"name", "process_name"}, {"ph", "M"}, {"pid", CPU_PID}, {"args", {{"name", "cpu"}}}});
+        events.push_back({{"name", "process_name"}, {"ph", "M"}, {"pid", GPU_PID}, {"args", {{"name", "gpu"}}}});
+
+        {
+            std::lock_guard<std::mutex> lock(threadBufferMutex);
+            std::vector<Event> eventVec;
+            for (auto&& buffer : threadBufferVec)
+            {
+                uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+                uint64_t begin = end > RING_SIZE ? end - RING_SIZE : 0;
+                eventVec.clear();
+                for (uint64_t i = begin; i < end; i++)
+                {
+                    eventVec.push_back(buffer->ring[i % RING_SIZE]);
+                }
+
+                // zones that ended while copying may have overwritten the oldest ones
+                uint64_t newEnd = buffer->writeIndex.load(std::memory_order_acquire);
+                uint64_t validBegin = std::max(begin, newEnd > RING_SIZE ? newEnd - RING_SIZE : 0);
+                size_t skip = (size_t)std::min(validBegin - begin, end - begin);
+                if (validBegin > 0 && skip < eventVec.size() && eventVec[skip].endNs > capture.beginNs)
+                {
+                    Log::W("TraceProfiler: ring buffer of thread %u wrapped, the oldest zones are missing\n", buffer->tid);
+                }
+
+                std::string name = buffer->name ? buffer->name : "thread " + std::to_string(buffer->tid);
+                events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", CPU_PID}, {"tid", buffer->tid},
+                                  {"args", {{"name", name}}}});
+                for (size_t i = skip; i < eventVec.size(); i++)
+                {
+                    const Event& e = eventVec[i];
+                    if (overlaps(e.beginNs, e.endNs))
+                    {
+                        events.push_back({{"name", e.name}, {"ph", "X"}, {"pid", CPU_PID}, {"tid", buffer->tid},
+                                          {"ts", toUs(e.beginNs)}, {"dur", (double)(e.endNs - e.beginNs) / 1000.0}});
+                    }
+                }
+            }
+        }
+
+        events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", GPU_PID}, {"tid", 0},
+                          {"args", {{"name", "gl"}}}});
+        for (auto&& e : capture.gpuEventVec)
+        {
+            events.push_back({{"name", e.name}, {"ph", "X"}, {"pid", GPU_PID}, {"tid", 0},
+                              {"ts", toUs(e.beginNs)}, {"dur", (double)(e.endNs - e.beginNs) / 1000.0}});
+        }
+
+        nlohmann::json trace;
+        trace["traceEvents"] = events;
+        trace["displayTimeUnit"] = "ms";
+        ofs << trace.dump() << std::endl;
+        return ofs.good();
+    }
+}
+
+std::atomic<bool> TraceProfiler::recording(false);
+
+int64_t TraceProfiler::NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TraceProfiler::Record(const char* name, int64_t beginNs, int64_t endNs)
+{
+    ThreadBuffer* buffer = GetThreadBuffer();
+    uint64_t i = buffer->writeIndex.load(std::memory_order_relaxed);
+    buffer->ring[i % RING_SIZE] = {name, beginNs, endNs};
+    buffer->writeIndex.store(i + 1, std::memory_order_release);
+}
+
+void TraceProfiler::SetThreadName(const char* name)
+{
+    threadName = name;
+    if (threadBuffer)
+    {
+        std::lock_guard<std::mutex> lock(threadBufferMutex);
+        threadBuffer->name = name;
+    }
+}
+
+void TraceProfiler::Capture(uint64_t firstFrame, uint64_t frameCount, const std::string& filename)
+{
+    recording.store(false, std::memory_order_relaxed);
+    capture.pending = true;
+    capture.filename = filename;
+    capture.firstFrame = std::max(firstFrame, frame);
+    capture.endFrame = capture.firstFrame + std::max(frameCount, (uint64_t)1);
+    capture.gpuEventVec.clear();
+
+    // the current frame is recorded from now on
+    if (capture.firstFrame == frame)
+    {
+        capture.beginNs = NowNs();
+        recording.store(true, std::memory_order_relaxed);
+    }
+}
+
+bool TraceProfiler::IsCapturePending()
+{
+    return capture.pending;
+}
+
+uint64_t TraceProfiler::GetFrame()
+{
+    return frame;
+}
+
+void TraceProfiler::AddGpuZone(const std::string& name, int64_t beginNs, int64_t endNs)
+{
+    // gpu work of the last captured frames completes after recording has stopped
+    bool captured = IsRecording() || (frame >= capture.endFrame && beginNs <= capture.endNs);
+    if (capture.pending && captured && beginNs >= capture.beginNs)
+    {
+        capture.gpuEventVec.push_back({name, beginNs, endNs});
+    }
+}
+
+void TraceProfiler::EndFrame()
+{
+    int64_t now = NowNs();
+    if (IsRecording())
+    {
+        Record("frame", std::max(frameBeginNs, capture.beginNs), now);
+    }
+    frameBeginNs = now;
+    frame++;
+
+    if (!capture.pending)
+    {
+        return;
+    }
+
+    if (frame == capture.firstFrame)
+    {
+        capture.beginNs = now;
+        recording.store(true, std::memory_order_relaxed);
+    }
+    else if (frame == capture.endFrame)
+    {
+        capture.endNs = now;
+        recording.store(false, std::memory_order_relaxed);
+    }
+    else if (frame == capture.endFrame + GPU_FRAME_LATENCY)
+    {
+        capture.pending = false;
+        if (WriteTrace())
+        {
+            Log::I("Wrote frames %llu to %llu to trace \"%s\"\n", (unsigned long long)capture.firstFrame,
+                   (unsigned long long)(capture.endFrame - 1), capture.filename.c_str());
+        }
+        else
+        {
+            Log::E("Error writing trace \"%s\"\n", capture.filename.c_str());
+        }
+        capture.gpuEventVec.clear();
+    }
+}
@@ -0,0 +1,65 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+// Records named cpu zones of every thread into a fixed size ring buffer per thread and writes the
+// zones of a range of frames, together with the gpu zones passed in, as a chrome trace json file
+// (chrome://tracing or ui.perfetto.dev). Zones cost one atomic load unless a capture is recording.
+class TraceProfiler
+{
+public:
+    // records the time between its constructor and destructor, name must be a string literal
+    class Zone
+    {
+    public:
+        Zone(const char* nameIn) : name(nameIn), beginNs(IsRecording() ? NowNs() : -1) {}
+        Zone(const Zone& orig) = delete;
+        ~Zone()
+        {
+            if (beginNs >= 0)
+            {
+                Record(name, beginNs, NowNs());
+            }
+        }
+    protected:
+        const char* name;
+        int64_t beginNs;
+    };
+
+    static int64_t NowNs();
+    static bool IsRecording() { return recording.load(std::memory_order_relaxed); }
+    // appends a zone to the ring buffer of the calling thread, lock free after the first call
+    static void Record(const char* name, int64_t beginNs, int64_t endNs);
+    // shown as the thread name in the trace, name must be a string literal
+    static void SetThreadName(const char* name);
+
+    // The following are only called from the thread that calls EndFrame().
+
+    // records the frames [firstFrame, firstFrame + frameCount) and writes them to filename a few
+    // frames after the last one, once its gpu zones have arrived. Replaces a pending capture.
+    static void Capture(uint64_t firstFrame, uint64_t frameCount, const std::string& filename);
+    static bool IsCapturePending();
+    // frames ended so far, frame 0 includes everything before the first EndFrame()
+    static uint64_t GetFrame();
+    // times are on the clock of NowNs(), zones outside of the captured frames are ignored
+    static void AddGpuZone(const std::string& name, int64_t beginNs, int64_t endNs);
+    static void EndFrame();
+
+protected:
+    static std::atomic<bool> recording;
+};
+
+// without tracy the zone macros record into the TraceProfiler, the color is dropped
+#ifndef TRACY_ENABLE
+#define TRACE_PROFILER_CONCAT_IMPL(a, b) a##b
+#define TRACE_PROFILER_CONCAT(a, b) TRACE_PROFILER_CONCAT_IMPL(a, b)
+#define ZoneScoped TraceProfiler::Zone TRACE_PROFILER_CONCAT(traceProfilerZone, __LINE__)(__func__)
+#define ZoneScopedNC(NAME, COLOR) TraceProfiler::Zone TRACE_PROFILER_CONCAT(traceProfilerZone, __LINE__)(NAME)
+#endif
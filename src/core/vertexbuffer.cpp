@@ -20,6 +20,7 @@
 #include <SDL2/SDL_opengl_glext.h>
 #endif
 
+#include "memorytracker.h"
 #include "util.h"
 
 #ifdef __ANDROID__
@@ -59,6 +60,8 @@ BufferObject::BufferObject(int targetIn, void* data, size_t size, unsigned int f
 	Bind();
     glBufferStorage(target, size, data, flags);
 	Unbind();
+	byteSize = size;
+	MemoryTracker::Alloc(MemoryTracker::BufferObjects, byteSize);
 	elementSize = 0;
 	numElements = 0;
 }
@@ -70,6 +73,8 @@ BufferObject::BufferObject(int targetIn, const std::vector<float>& data, unsigne
 	Bind();
     glBufferStorage(target, sizeof(float) * data.size(), (void*)data.data(), flags);
 	Unbind();
+	byteSize = sizeof(float) * data.size();
+	MemoryTracker::Alloc(MemoryTracker::BufferObjects, byteSize);
 	elementSize = 1;
 	numElements = (int)data.size();
 }
@@ -81,6 +86,8 @@ BufferObject::BufferObject(int targetIn, const std::vector<glm::vec2>& data, uns
 	Bind();
     glBufferStorage(target, sizeof(glm::vec2) * data.size(), (void*)data.data(), flags);
 	Unbind();
+	byteSize = sizeof(glm::vec2) * data.size();
+	MemoryTracker::Alloc(MemoryTracker::BufferObjects, byteSize);
 	elementSize = 2;
 	numElements = (int)data.size();
 }
@@ -92,6 +99,8 @@ BufferObject::BufferObject(int targetIn, const std::vector<glm::vec3>& data, uns
 	Bind();
     glBufferStorage(target, sizeof(glm::vec3) * data.size(), (void*)data.data(), flags);
 	Unbind();
+	byteSize = sizeof(glm::vec3) * data.size();
+	MemoryTracker::Alloc(MemoryTracker::BufferObjects, byteSize);
 	elementSize = 3;
 	numElements = (int)data.size();
 }
@@ -103,6 +112,8 @@ BufferObject::BufferObject(int targetIn, const std::vector<glm::vec4>& data, uns
 	Bind();
     glBufferStorage(target, sizeof(glm::vec4) * data.size(), (void*)data.data(), flags);
 	Unbind();
+	byteSize = sizeof(glm::vec4) * data.size();
+	MemoryTracker::Alloc(MemoryTracker::BufferObjects, byteSize);
 	elementSize = 4;
 	numElements = (int)data.size();
 }
@@ -114,6 +125,8 @@ BufferObject::BufferObject(int targetIn, const std::vector<uint32_t>& data, unsi
 	Bind();
     glBufferStorage(target, sizeof(uint32_t) * data.size(), (void*)data.data(), flags);
 	Unbind();
+	byteSize = sizeof(uint32_t) * data.size();
+	MemoryTracker::Alloc(MemoryTracker::BufferObjects, byteSize);
 	elementSize = 1;
 	numElements = (int)data.size();
 }
@@ -121,6 +134,7 @@ BufferObject::BufferObject(int targetIn, const std::vector<uint32_t>& data, unsi
 BufferObject::~BufferObject()
 {
     glDeleteBuffers(1, &obj);
+	MemoryTracker::Free(MemoryTracker::BufferObjects, byteSize);
 }
 
 void BufferObject::Bind() const
@@ -183,6 +197,34 @@ void BufferObject::Read(std::vector<uint32_t>& data)
 	Unbind();
 }
 
+bool BufferObject::Read(size_t offset, size_t size, void* data) const
+{
+	if (offset + size > byteSize)
+	{
+		return false;
+	}
+
+	GLuint staging = 0;
+	glGenBuffers(1, &staging);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, staging);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, GL_MAP_READ_BIT);
+	glBindBuffer(GL_COPY_READ_BUFFER, obj);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size);
+	// waits for the copy
+	void* rawBuffer = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, GL_MAP_READ_BIT);
+	if (rawBuffer)
+	{
+		memcpy(data, rawBuffer, size);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &staging);
+
+	GL_ERROR_CHECK("BufferObject::Read()");
+	return rawBuffer != nullptr;
+}
+
 VertexArrayObject::VertexArrayObject()
 {
 	glGenVertexArrays(1, &obj);
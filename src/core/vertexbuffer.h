@@ -50,6 +50,8 @@ public:
 	void Update(const std::vector<uint32_t>& data);
 
 	void Read(std::vector<uint32_t>& data);
+	// copies a range through a temporary buffer, so it also works without GL_MAP_READ_BIT
+	bool Read(size_t offset, size_t size, void* data) const;
 
 	uint32_t GetObj() const { return obj; }
 
@@ -58,6 +60,7 @@ protected:
     uint32_t obj;
 	int elementSize;  // vec2 = 2, vec3 = 3 etc.
 	int numElements;  // number of vec2, vec3 in buffer
+	size_t byteSize;
 };
 
 class VertexArrayObject
@@ -0,0 +1,105 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#include "viewuniforms.h"
+
+#include <cstddef>
+
+#ifdef __ANDROID__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES3/gl3ext.h>
+#else
+#include <GL/glew.h>
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL2/SDL_opengl.h>
+#include <SDL2/SDL_opengl_glext.h>
+#endif
+
+#include "log.h"
+#include "util.h"
+
+// members are read as view.viewMat etc. the binding is VIEW_BLOCK_BINDING. Explicit precision
+// keeps the vertex and fragment declarations identical on gles, their default int precisions differ.
+static const char* VIEW_BLOCK_DECLARATION = R"(
+layout(std140, binding = 0) uniform ViewBlock
+{
+    highp mat4 viewMat;
+    highp mat4 projMat;
+    highp mat4 invViewMat;
+    highp mat4 invProjMat;
+    highp mat4 viewProjMat;
+    highp mat4 invViewProjMat;
+    highp vec4 viewport;
+    highp vec4 eye;
+    highp vec2 nearFar;
+    highp uint frameIndex;
+    highp uint randomSeed;
+} view;
+)";
+
+// std140 packs every member of the block without padding
+static_assert(sizeof(ViewUniforms::Block) == 6 * 64 + 2 * 16 + 8 + 4 + 4, "ViewBlock layout mismatch");
+static_assert(offsetof(ViewUniforms::Block, frameIndex) == 424, "ViewBlock layout mismatch");
+
+const char* ViewUniforms::GetBlockDeclaration()
+{
+    return VIEW_BLOCK_DECLARATION;
+}
+
+ViewUniforms::ViewUniforms() : block()
+{
+}
+
+ViewUniforms::~ViewUniforms()
+{
+    if (ubo)
+    {
+        glDeleteBuffers(1, &ubo);
+    }
+}
+
+bool ViewUniforms::Init()
+{
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), &block, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    GL_ERROR_CHECK("ViewUniforms::Init()");
+
+    return true;
+}
+
+void ViewUniforms::Update(const glm::mat4& cameraMat, const glm::mat4& projMat,
+                          const glm::vec4& viewport, const glm::vec2& nearFar)
+{
+    block.viewMat = glm::inverse(cameraMat);
+    block.projMat = projMat;
+    block.invViewMat = cameraMat;
+    block.invProjMat = glm::inverse(projMat);
+    block.viewProjMat = projMat * block.viewMat;
+    block.invViewProjMat = cameraMat * block.invProjMat;
+    block.viewport = viewport;
+    block.eye = cameraMat[3];
+    block.nearFar = nearFar;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, VIEW_BLOCK_BINDING, ubo);
+}
+
+void ViewUniforms::UpdateNoise(uint32_t frameIndex, uint32_t randomSeed)
+{
+    block.frameIndex = frameIndex;
+    block.randomSeed = randomSeed;
+
+    const size_t offset = offsetof(Block, frameIndex);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, 2 * sizeof(uint32_t), &block.frameIndex);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,56 @@
+/*
+    Copyright (c) 2024 Anthony J. Thibault
+    This software is licensed under the MIT License. See LICENSE for more details.
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+// Constants shared by every draw of a view, in a std140 uniform buffer instead of per program
+// uniforms. Shaders declare the block with /*%%VIEW_BLOCK%%*/, it is bound to
+// VIEW_BLOCK_BINDING so every program sees the last Update().
+class ViewUniforms
+{
+public:
+    static const uint32_t VIEW_BLOCK_BINDING = 0;
+
+    // glsl declaration of the block, expanded by Program for /*%%VIEW_BLOCK%%*/
+    static const char* GetBlockDeclaration();
+
+    // mirrors the glsl ViewBlock, std140 layout
+    struct Block
+    {
+        glm::mat4 viewMat;
+        glm::mat4 projMat;
+        glm::mat4 invViewMat;  // camera to world
+        glm::mat4 invProjMat;
+        glm::mat4 viewProjMat;
+        glm::mat4 invViewProjMat;
+        glm::vec4 viewport;  // x, y, width, height
+        glm::vec4 eye;  // world position of the camera, w = 1
+        glm::vec2 nearFar;
+        uint32_t frameIndex;
+        uint32_t randomSeed;
+    };
+
+    ViewUniforms();
+    ~ViewUniforms();
+
+    bool Init();
+
+    // viewport = (x, y, width, height), uploads the whole block and binds it
+    void Update(const glm::mat4& cameraMat, const glm::mat4& projMat,
+                const glm::vec4& viewport, const glm::vec2& nearFar);
+
+    // only rewrites frameIndex and randomSeed, for stochastic draws that want new samples
+    // within the same view
+    void UpdateNoise(uint32_t frameIndex, uint32_t randomSeed);
+
+    const Block& GetBlock() const { return block; }
+
+protected:
+    Block block;
+    uint32_t ubo = 0;
+};
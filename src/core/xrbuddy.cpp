@@ -20,8 +20,7 @@
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
 #else
-#define ZoneScoped
-#define ZoneScopedNC(NAME, COLOR)
+#include "traceprofiler.h"
 #endif
 
 #include "log.h"
@@ -910,7 +909,7 @@ static bool CreateSwapchains(XrInstance instance, XrSession session,
         uint32_t swapchainSampleCount = 1;
         if (sampleCount > 1)
         {
-            Log::I("Using application-level %dx super sampling for view %d\n", sampleCount, i);
+            Log::I("Using application-level %dx multisampling for view %d\n", sampleCount, i);
         }
         
         XrSwapchainCreateInfo sci = {};
@@ -1044,6 +1043,71 @@ static bool CreateSuperSampleBuffers(GLint targetWidth, GLint targetHeight, int
     return true;
 }
 
+// the number of samples the driver allocates for an RGBA8 MSAA buffer, at most GL_MAX_SAMPLES and
+// possibly more than requested
+static int QueryMultiSampleCount(int sampleCount)
+{
+    GLint maxSamples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    sampleCount = std::min(sampleCount, (int)maxSamples);
+
+    GLuint renderbuffer = 0;
+    glGenRenderbuffers(1, &renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, sampleCount, GL_RGBA8, 1, 1);
+    GLint samples = 0;
+    glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_SAMPLES, &samples);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glDeleteRenderbuffers(1, &renderbuffer);
+    return (int)samples;
+}
+
+static bool CreateMultiSampleBuffers(GLint targetWidth, GLint targetHeight, int sampleCount, SuperSampleBuffers& buffers)
+{
+    GLint maxSamples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    if (sampleCount > maxSamples)
+    {
+        Log::W("Requested %d MSAA samples, max is %d\n", sampleCount, maxSamples);
+        sampleCount = maxSamples;
+    }
+
+    buffers.multiSample = true;
+    buffers.targetWidth = targetWidth;
+    buffers.targetHeight = targetHeight;
+    buffers.superWidth = targetWidth;
+    buffers.superHeight = targetHeight;
+
+    glGenFramebuffers(1, &buffers.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, buffers.framebuffer);
+
+    glGenRenderbuffers(1, &buffers.colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, buffers.colorRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, sampleCount, GL_RGBA8, targetWidth, targetHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, buffers.colorRenderbuffer);
+
+    glGenRenderbuffers(1, &buffers.depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, buffers.depthRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, sampleCount, GL_DEPTH_COMPONENT24, targetWidth, targetHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, buffers.depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    // Create resolve framebuffer
+    glGenFramebuffers(1, &buffers.resolveFramebuffer);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        Log::E("Multisample framebuffer incomplete: 0x%x\n", status);
+        return false;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    Log::I("Created multisample buffers %dx%d (%dx MSAA)\n", targetWidth, targetHeight, sampleCount);
+    return true;
+}
+
 static void DestroySuperSampleBuffers(SuperSampleBuffers& buffers)
 {
     if (buffers.framebuffer)
@@ -1066,13 +1130,24 @@ static void DestroySuperSampleBuffers(SuperSampleBuffers& buffers)
         glDeleteFramebuffers(1, &buffers.resolveFramebuffer);
         buffers.resolveFramebuffer = 0;
     }
+    if (buffers.colorRenderbuffer)
+    {
+        glDeleteRenderbuffers(1, &buffers.colorRenderbuffer);
+        buffers.colorRenderbuffer = 0;
+    }
+    if (buffers.depthRenderbuffer)
+    {
+        glDeleteRenderbuffers(1, &buffers.depthRenderbuffer);
+        buffers.depthRenderbuffer = 0;
+    }
 }
 
-XrBuddy::XrBuddy(MainContext& mainContextIn, const glm::vec2& nearFarIn, int sampleCountIn):
+XrBuddy::XrBuddy(MainContext& mainContextIn, const glm::vec2& nearFarIn, int sampleCountIn, bool multiSampleIn):
     mainContext(mainContextIn)
 {
     nearFar = nearFarIn;
     sampleCount = sampleCountIn;
+    multiSample = multiSampleIn;
 
 #ifdef XR_USE_GRAPHICS_API_OPENGL
     std::vector<const char*> requiredExtensionVec = {XR_KHR_OPENGL_ENABLE_EXTENSION_NAME};
@@ -1184,6 +1259,17 @@ bool XrBuddy::Init()
         return false;
     }
 
+    if (multiSample && sampleCount > 1)
+    {
+        // the msaa buffers are created on first use, the renderer needs the real count before that
+        int grantedCount = QueryMultiSampleCount(sampleCount);
+        if (grantedCount != sampleCount)
+        {
+            Log::W("Requested %d MSAA samples, the driver provides %d\n", sampleCount, grantedCount);
+            sampleCount = std::max(grantedCount, 1);
+        }
+    }
+
     if (!CreateSwapchains(instance, session, viewConfigs, swapchains, swapchainImages, sampleCount))
     {
         return false;
@@ -1580,6 +1666,11 @@ uint32_t XrBuddy::GetColorTexture() const
     return prevLastColorTexture;
 }
 
+glm::ivec2 XrBuddy::GetColorTextureSize() const
+{
+    return swapchains.empty() ? glm::ivec2(0, 0) : glm::ivec2(swapchains[0].width, swapchains[0].height);
+}
+
 void XrBuddy::CycleColorSpace()
 {
     static int i = 0;
@@ -1917,7 +2008,9 @@ void XrBuddy::RenderView(const XrCompositionLayerProjectionView& layerView, uint
         {
             // Create new super sample buffers for this size if they don't exist
             SuperSampleBuffers newBuffers;
-            if (CreateSuperSampleBuffers(width, height, sampleCount, newBuffers))
+            bool created = multiSample ? CreateMultiSampleBuffers(width, height, sampleCount, newBuffers) :
+                                         CreateSuperSampleBuffers(width, height, sampleCount, newBuffers);
+            if (created)
             {
                 ssIter = superSampleBuffersMap.insert({sizeKey, newBuffers}).first;
             }
@@ -1956,9 +2049,10 @@ void XrBuddy::RenderView(const XrCompositionLayerProjectionView& layerView, uint
             glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ssBuffers.resolveFramebuffer);
             glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
 
+            // an MSAA resolve must not scale and only allows nearest filtering
             glBlitFramebuffer(0, 0, ssBuffers.superWidth, ssBuffers.superHeight,
                               0, 0, ssBuffers.targetWidth, ssBuffers.targetHeight,
-                              GL_COLOR_BUFFER_BIT, GL_LINEAR);
+                              GL_COLOR_BUFFER_BIT, ssBuffers.multiSample ? GL_NEAREST : GL_LINEAR);
 
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
             return; // Finished rendering this view
@@ -61,6 +61,10 @@ struct SuperSampleBuffers {
     GLuint colorTexture;
     GLuint depthTexture;
     GLuint resolveFramebuffer;
+    // MSAA path, the scene is rendered at target size into multisampled renderbuffers
+    GLuint colorRenderbuffer;
+    GLuint depthRenderbuffer;
+    bool multiSample;
 
     GLsizei targetWidth;
     GLsizei targetHeight;
@@ -68,15 +72,19 @@ struct SuperSampleBuffers {
     GLsizei superHeight;
     
     SuperSampleBuffers() : framebuffer(0), colorTexture(0), depthTexture(0), resolveFramebuffer(0),
+                         colorRenderbuffer(0), depthRenderbuffer(0), multiSample(false),
                          targetWidth(0), targetHeight(0), superWidth(0), superHeight(0) {}
 };
 
 class XrBuddy
 {
 public:
-    XrBuddy(MainContext& mainContextIn, const glm::vec2& nearFarIn, int sampleCountIn);
+    // multiSampleIn, render into an MSAA target with sampleCountIn samples instead of supersampling
+    XrBuddy(MainContext& mainContextIn, const glm::vec2& nearFarIn, int sampleCountIn, bool multiSampleIn = false);
 
     bool Init();
+    // after Init(), the samples of the MSAA target, which can differ from the requested count
+    int GetSampleCount() const { return sampleCount; }
     bool PollEvents();
     bool SyncInput();
 
@@ -129,6 +137,7 @@ public:
     bool GetActionAngularVelocity(const std::string& actionName, glm::vec3* value, bool* valid) const;
 
     uint32_t GetColorTexture() const;
+    glm::ivec2 GetColorTextureSize() const;
 
     void CycleColorSpace();
 
@@ -183,4 +192,5 @@ protected:
     RenderCallback renderCallback;
     glm::vec2 nearFar;
     int sampleCount;
+    bool multiSample;
 };
@@ -20,11 +20,12 @@
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
 #else
-#define ZoneScoped
-#define ZoneScopedNC(NAME, COLOR)
+#include "core/traceprofiler.h"
 #endif
 
 #include "core/log.h"
+#include "core/memorytracker.h"
+#include "core/startupreport.h"
 #include "core/util.h"
 
 #include "ply.h"
@@ -55,6 +56,22 @@ struct FullGaussianData : public BaseGaussianData
     float b_sh3[4];
 };
 
+// ForEachPosWithAlpha() fetches released splats in pieces of about this size
+static const size_t FETCH_CHUNK_SIZE = 16 * 1024 * 1024;
+
+// counted by the MemoryTracker until the last reference is dropped
+template <typename T>
+static std::shared_ptr<void> MakeGaussianData(size_t count)
+{
+    size_t bytes = sizeof(T) * count;
+    MemoryTracker::Alloc(MemoryTracker::GaussianCloudData, bytes);
+    return std::shared_ptr<void>(new T[count], [bytes](void* ptr)
+    {
+        delete [] static_cast<T*>(ptr);
+        MemoryTracker::Free(MemoryTracker::GaussianCloudData, bytes);
+    });
+}
+
 // Function to convert glm::mat3 to Eigen::Matrix3f
 static Eigen::Matrix3f glmToEigen(const glm::mat3& glmMat)
 {
@@ -150,6 +167,7 @@ bool GaussianCloud::ImportPly(const std::string& plyFilename)
 
     {
         ZoneScopedNC("ply.Parse", tracy::Color::Blue);
+        StartupReport::Phase phase("ply parse");
         if (!ply.Parse(plyFile))
         {
             Log::E("Error parsing ply file \"%s\"\n", plyFilename.c_str());
@@ -229,6 +247,9 @@ bool GaussianCloud::ImportPly(const std::string& plyFilename)
 
     InitAttribs();
 
+    // converting the ply vertices into the gaussian layout
+    StartupReport::Phase conversionPhase("ply conversion");
+
     {
         ZoneScopedNC("alloc data", tracy::Color::Red4);
 
@@ -236,15 +257,14 @@ bool GaussianCloud::ImportPly(const std::string& plyFilename)
         if (hasFullSH)
         {
             gaussianSize = sizeof(FullGaussianData);
-            FullGaussianData* fullPtr = new FullGaussianData[numGaussians];
-            data.reset(fullPtr);
+            data = MakeGaussianData<FullGaussianData>(numGaussians);
         }
         else
         {
             gaussianSize = sizeof(BaseGaussianData);
-            BaseGaussianData* basePtr = new BaseGaussianData[numGaussians];
-            data.reset(basePtr);
+            data = MakeGaussianData<BaseGaussianData>(numGaussians);
         }
+        fetcher = nullptr;
     }
 
     {
@@ -435,9 +455,16 @@ bool GaussianCloud::ExportPly(const std::string& plyFilename) const
     ply.GetProperty("rot_2", props.rot[2]);
     ply.GetProperty("rot_3", props.rot[3]);
 
+    std::shared_ptr<const void> srcData = FetchData();
+    if (!srcData)
+    {
+        Log::E("Error exporting \"%s\", the splats could not be fetched\n", plyFilename.c_str());
+        return false;
+    }
+
     ply.AllocData(numGaussians);
 
-    uint8_t* gData = (uint8_t*)data.get();
+    const uint8_t* gData = (const uint8_t*)srcData.get();
     size_t runningSize = 0;
     ply.ForEachVertexMut([this, &props, &gData, &runningSize](void* plyData, size_t size)
     {
@@ -509,8 +536,9 @@ void GaussianCloud::InitDebugCloud()
     numGaussians = NUM_SPLATS * 3 + 1;
     gaussianSize = sizeof(FullGaussianData);
     InitAttribs();
-    FullGaussianData* gd = new FullGaussianData[numGaussians];
-    data.reset(gd);
+    data = MakeGaussianData<FullGaussianData>(numGaussians);
+    fetcher = nullptr;
+    FullGaussianData* gd = static_cast<FullGaussianData*>(data.get());
 
     //
     // make an debug GaussianClound, that contain red, green and blue axes.
@@ -580,18 +608,24 @@ void GaussianCloud::InitDebugCloud()
 // only keep the nearest splats
 void GaussianCloud::PruneSplats(const glm::vec3& origin, uint32_t numSplats)
 {
-    if (!data || static_cast<size_t>(numSplats) >= numGaussians)
+    if ((!data && !fetcher) || static_cast<size_t>(numSplats) >= numGaussians)
     {
         return;
     }
+    std::shared_ptr<const void> srcData = FetchData();
+    if (!srcData)
+    {
+        Log::E("Error pruning splats, they could not be fetched\n");
+        return;
+    }
 
     using IndexDistPair = std::pair<uint32_t, float>;
     std::vector<IndexDistPair> indexDistVec;
     indexDistVec.reserve(numGaussians);
-    uint8_t* rawPtr = (uint8_t*)data.get();
+    const uint8_t* rawPtr = (const uint8_t*)srcData.get();
     for (uint32_t i = 0; i < numGaussians; i++)
     {
-        BaseGaussianData* basePtr = reinterpret_cast<BaseGaussianData*>(rawPtr);
+        const BaseGaussianData* basePtr = reinterpret_cast<const BaseGaussianData*>(rawPtr);
         glm::vec3 pos(basePtr->posWithAlpha[0], basePtr->posWithAlpha[1], basePtr->posWithAlpha[2]);
         indexDistVec.push_back(IndexDistPair(i, glm::distance(origin, pos)));
         rawPtr += gaussianSize;
@@ -602,19 +636,17 @@ void GaussianCloud::PruneSplats(const glm::vec3& origin, uint32_t numSplats)
         return a.second < b.second;
     });
 
-    uint8_t* newData;
-    if (hasFullSH)
+    std::shared_ptr<void> newData;
+    if (gaussianSize == sizeof(FullGaussianData))
     {
-        FullGaussianData* fullPtr = new FullGaussianData[numSplats];
-        newData = (uint8_t*)fullPtr;
+        newData = MakeGaussianData<FullGaussianData>(numSplats);
     }
     else
     {
-        BaseGaussianData* basePtr = new BaseGaussianData[numSplats];
-        newData = (uint8_t*)basePtr;
+        newData = MakeGaussianData<BaseGaussianData>(numSplats);
     }
-    rawPtr = (uint8_t*)data.get();
-    uint8_t* rawPtr2 = newData;
+    rawPtr = (const uint8_t*)srcData.get();
+    uint8_t* rawPtr2 = (uint8_t*)newData.get();
 
     for (uint32_t i = 0; i < numSplats; i++)
     {
@@ -622,12 +654,73 @@ void GaussianCloud::PruneSplats(const glm::vec3& origin, uint32_t numSplats)
         rawPtr2 += gaussianSize;
     }
     numGaussians = numSplats;
-    data.reset(newData);
+    // the pruned splats are not where the fetcher reads from
+    data = newData;
+    fetcher = nullptr;
 }
 
-void GaussianCloud::ForEachPosWithAlpha(const ForEachPosWithAlphaCallback& cb) const
+bool GaussianCloud::ForEachPosWithAlpha(const ForEachPosWithAlphaCallback& cb) const
 {
-    posWithAlphaAttrib.ForEach<float>(GetRawDataPtr(), GetStride(), GetNumGaussians(), cb);
+    if (data)
+    {
+        posWithAlphaAttrib.ForEach<float>(GetRawDataPtr(), GetStride(), GetNumGaussians(), cb);
+        return true;
+    }
+
+    ZoneScopedNC("GC::ForEachPosWithAlpha fetch", tracy::Color::Red4);
+    if (!fetcher)
+    {
+        return numGaussians == 0;
+    }
+    const size_t chunkCount = std::max(FETCH_CHUNK_SIZE / gaussianSize, (size_t)1);
+    std::vector<uint8_t> chunk(chunkCount * gaussianSize);
+    for (size_t i = 0; i < numGaussians; i += chunkCount)
+    {
+        size_t count = std::min(chunkCount, numGaussians - i);
+        if (!fetcher(i * gaussianSize, count * gaussianSize, chunk.data()))
+        {
+            Log::E("Error fetching released splats\n");
+            return false;
+        }
+        posWithAlphaAttrib.ForEach<float>(chunk.data(), GetStride(), count, cb);
+    }
+    return true;
+}
+
+void GaussianCloud::ReleaseData(const DataFetcher& fetcherIn)
+{
+    if (!data)
+    {
+        return;
+    }
+    fetcher = fetcherIn;
+    data.reset();
+    Log::D("released the cpu copy of %d splats, %.1f MB\n", (int)numGaussians, (double)GetTotalSize() / (1024.0 * 1024.0));
+}
+
+std::shared_ptr<const void> GaussianCloud::FetchData() const
+{
+    if (data || !fetcher)
+    {
+        return data;
+    }
+
+    ZoneScopedNC("GC::FetchData", tracy::Color::Red4);
+    std::shared_ptr<void> fetched;
+    if (gaussianSize == sizeof(FullGaussianData))
+    {
+        fetched = MakeGaussianData<FullGaussianData>(numGaussians);
+    }
+    else
+    {
+        fetched = MakeGaussianData<BaseGaussianData>(numGaussians);
+    }
+    if (!fetcher(0, GetTotalSize(), fetched.get()))
+    {
+        Log::E("Error fetching released splats\n");
+        return nullptr;
+    }
+    return fetched;
 }
 
 void GaussianCloud::InitAttribs()
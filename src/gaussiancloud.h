@@ -36,9 +36,21 @@ public:
     size_t GetNumGaussians() const { return numGaussians; }
     size_t GetStride() const { return gaussianSize; }
     size_t GetTotalSize() const { return GetNumGaussians() * gaussianSize; }
+    // nullptr after ReleaseData(), see FetchData()
     void* GetRawDataPtr() { return data.get(); }
     const void* GetRawDataPtr() const { return data.get(); }
 
+    // reads size bytes of the gaussian data starting at offset into dataOut, e.g. back from the gpu
+    using DataFetcher = std::function<bool(size_t offset, size_t size, void* dataOut)>;
+
+    // Frees the cpu copy of the splats once they live elsewhere, typically in the vertex buffer of the
+    // splat renderer. Whatever reads them afterwards gets them through fetcher, for as long as it needs
+    // them: ExportPly() and PruneSplats() fetch everything, ForEachPosWithAlpha() a chunk at a time.
+    void ReleaseData(const DataFetcher& fetcherIn);
+    bool IsDataResident() const { return data != nullptr; }
+    // the cpu copy, or a temporary one fetched again after ReleaseData(), nullptr if that failed
+    std::shared_ptr<const void> FetchData() const;
+
     const BinaryAttribute& GetPosWithAlphaAttrib() const { return posWithAlphaAttrib; }
     const BinaryAttribute& GetR_SH0Attrib() const { return r_sh0Attrib; }
     const BinaryAttribute& GetR_SH1Attrib() const { return r_sh1Attrib; }
@@ -57,7 +69,8 @@ public:
     const BinaryAttribute& GetCov3_Col2Attrib() const { return cov3_col2Attrib; }
 
     using ForEachPosWithAlphaCallback = std::function<void(const float*)>;
-    void ForEachPosWithAlpha(const ForEachPosWithAlphaCallback& cb) const;
+    // false if the splats were released and could not be fetched
+    bool ForEachPosWithAlpha(const ForEachPosWithAlphaCallback& cb) const;
 
     bool HasFullSH() const { return hasFullSH; }
 
@@ -65,6 +78,7 @@ protected:
     void InitAttribs();
 
     std::shared_ptr<void> data;
+    DataFetcher fetcher;  // set while data is released
 
     BinaryAttribute posWithAlphaAttrib;
     BinaryAttribute r_sh0Attrib;
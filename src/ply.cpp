@@ -13,11 +13,11 @@
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
 #else
-#define ZoneScoped
-#define ZoneScopedNC(NAME, COLOR)
+#include "core/traceprofiler.h"
 #endif
 
 #include "core/log.h"
+#include "core/memorytracker.h"
 
 static bool CheckLine(std::ifstream& plyFile, const std::string& validLine)
 {
@@ -64,11 +64,16 @@ static const char* BinaryAttributeTypeToString(BinaryAttribute::Type type)
     };
 }
 
-Ply::Ply() : vertexCount(0), vertexSize(0)
+Ply::Ply() : vertexCount(0), vertexSize(0), dataSize(0)
 {
     ;
 }
 
+Ply::~Ply()
+{
+    MemoryTracker::Free(MemoryTracker::PlyData, dataSize);
+}
+
 bool Ply::Parse(std::ifstream& plyFile)
 {
     if (!ParseHeader(plyFile))
@@ -115,6 +120,9 @@ void Ply::AllocData(size_t numVertices)
 {
     vertexCount = numVertices;
     data.reset(new uint8_t[vertexSize * numVertices]);
+    MemoryTracker::Free(MemoryTracker::PlyData, dataSize);
+    dataSize = vertexSize * numVertices;
+    MemoryTracker::Alloc(MemoryTracker::PlyData, dataSize);
 }
 
 void Ply::ForEachVertex(const VertexCallback& cb) const
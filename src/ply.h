@@ -20,6 +20,7 @@ class Ply
 {
 public:
     Ply();
+    ~Ply();
     bool Parse(std::ifstream& plyFile);
     void Dump(std::ofstream& plyFile) const;
 
@@ -40,7 +41,8 @@ protected:
     void DumpHeader(std::ofstream& plyFile) const;
 
     std::unordered_map<std::string, BinaryAttribute> propertyMap;
-    std::unique_ptr<uint8_t> data;
+    std::unique_ptr<uint8_t[]> data;
     size_t vertexCount;
     size_t vertexSize;
+    size_t dataSize;
 };
@@ -19,8 +19,7 @@
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
 #else
-#define ZoneScoped
-#define ZoneScopedNC(NAME, COLOR)
+#include "core/traceprofiler.h"
 #endif
 
 #include "core/image.h"
@@ -117,9 +116,9 @@ void PointRenderer::Render(const glm::mat4& cameraMat, const glm::mat4& projMat,
         ZoneScopedNC("pre-sort", tracy::Color::Red4);
 
         preSortProg->Bind();
-        preSortProg->SetUniform("modelViewProj", projMat * modelViewMat);
-        preSortProg->SetUniform("nearFar", nearFar);
-        preSortProg->SetUniform("keyMax", MAX_DEPTH);
+        preSortProg->SetUniform(preSortUniforms.modelViewProj, projMat * modelViewMat);
+        preSortProg->SetUniform(preSortUniforms.nearFar, nearFar);
+        preSortProg->SetUniform(preSortUniforms.keyMax, MAX_DEPTH);
 
         glm::mat4 modelViewProjMat = projMat * modelViewMat;
 
@@ -177,15 +176,15 @@ void PointRenderer::Render(const glm::mat4& cameraMat, const glm::mat4& projMat,
         float aspectRatio = width / height;
 
         pointProg->Bind();
-        pointProg->SetUniform("modelViewMat", modelViewMat);
-        pointProg->SetUniform("projMat", projMat);
-        pointProg->SetUniform("pointSize", 0.02f);  // in ndc space?!?
-        pointProg->SetUniform("invAspectRatio", 1.0f / aspectRatio);
+        pointProg->SetUniform(pointUniforms.modelViewMat, modelViewMat);
+        pointProg->SetUniform(pointUniforms.projMat, projMat);
+        pointProg->SetUniform(pointUniforms.pointSize, 0.02f);  // in ndc space?!?
+        pointProg->SetUniform(pointUniforms.invAspectRatio, 1.0f / aspectRatio);
 
         // use texture unit 0 for colorTexture
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, pointTex->texture);
-        pointProg->SetUniform("colorTex", 0);
+        pointProg->SetUniform(pointUniforms.colorTex, 0);
 
         pointVao->Bind();
         glDrawElements(GL_POINTS, sortCount, GL_UNSIGNED_INT, nullptr);
@@ -40,6 +40,20 @@ protected:
     std::shared_ptr<Program> preSortProg;
     std::shared_ptr<VertexArrayObject> pointVao;
 
+    // looked up once instead of by name every frame
+    struct PointUniforms {
+        Program::Uniform<glm::mat4> modelViewMat{"modelViewMat"};
+        Program::Uniform<glm::mat4> projMat{"projMat"};
+        Program::Uniform<float> pointSize{"pointSize"};
+        Program::Uniform<float> invAspectRatio{"invAspectRatio"};
+        Program::Uniform<int32_t> colorTex{"colorTex"};
+    } pointUniforms;
+    struct PreSortUniforms {
+        Program::Uniform<glm::mat4> modelViewProj{"modelViewProj"};
+        Program::Uniform<glm::vec2> nearFar{"nearFar"};
+        Program::Uniform<uint32_t> keyMax{"keyMax"};
+    } preSortUniforms;
+
     std::shared_ptr<BufferObject> pointDataBuffer;
 
     std::vector<uint32_t> indexVec;
@@ -159,6 +159,7 @@ int main(int argc, char *argv[])
     });
 
     uint32_t frameCount = 1;
+    uint32_t fpsFrameCount = 0;
     uint32_t frameTicks = SDL_GetTicks();
     uint32_t lastTicks = SDL_GetTicks();
     while (!ctx.quitting && !shouldQuit)
@@ -167,11 +168,12 @@ int main(int argc, char *argv[])
         uint32_t ticks = SDL_GetTicks();
 
         const int FPS_FRAMES = 100;
-        if ((frameCount % FPS_FRAMES) == 0)
+        if ((frameCount % FPS_FRAMES) == 0 && frameCount != fpsFrameCount)
         {
             float delta = (ticks - frameTicks) / 1000.0f;
             float fps = (float)FPS_FRAMES / delta;
             frameTicks = ticks;
+            fpsFrameCount = frameCount;
             app.UpdateFps(fps);
         }
         float dt = (ticks - lastTicks) / 1000.0f;
@@ -189,10 +191,22 @@ int main(int argc, char *argv[])
             return 1;
         }
 
-        SDL_GL_MakeCurrent(ctx.window, ctx.gl_context);
-
         int width, height;
         SDL_GetWindowSize(ctx.window, &width, &height);
+        if (app.IsIdle(glm::ivec2(width, height)))
+        {
+            // the converged image is still on screen, sleep until there is input instead of spinning.
+            const int IDLE_WAIT_MS = 100;
+            SDL_WaitEventTimeout(NULL, IDLE_WAIT_MS);
+
+            // don't count the time spent waiting towards dt or fps
+            uint32_t idleTicks = SDL_GetTicks() - ticks;
+            lastTicks += idleTicks;
+            frameTicks += idleTicks;
+            continue;
+        }
+
+        SDL_GL_MakeCurrent(ctx.window, ctx.gl_context);
         if (!app.Render(dt, glm::ivec2(width, height)))
         {
             Log::E("App::Render failed!\n");
@@ -206,6 +220,8 @@ int main(int argc, char *argv[])
         FrameMark;
     }
 
+    app.Shutdown();
+
     SDL_DelEventWatch(Watch, NULL);
     SDL_GL_DeleteContext(ctx.gl_context);
 
@@ -5,7 +5,9 @@
     Modified by: Shakiba Kheradmand, 2025
 */
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <limits>
 #include <memory>
 #include <random>
@@ -22,14 +24,17 @@
 #ifdef TRACY_ENABLE
   #include <tracy/Tracy.hpp>
 #else
-  #define ZoneScoped
-  #define ZoneScopedNC(NAME, COLOR)
+  #include "core/traceprofiler.h"
 #endif
 
 #include "splatrenderer.h"
 #include "gaussiancloud.h"
+#include "core/bluenoise.h"
+#include "core/gpuprofiler.h"
 #include "core/image.h"
 #include "core/log.h"
+#include "core/memorytracker.h"
+#include "core/startupreport.h"
 #include "core/texture.h"
 #include "core/util.h"
 #include "radix_sort.hpp"
@@ -37,18 +42,47 @@
 using namespace splat;
 
 static const uint32_t NUM_BLOCKS_PER_WORKGROUP = 1024;
-// Full-screen quad vertices (positions and texCoords), for triangle strip
-static const float quadVertices[] = {
-    // positions   // texCoords
-    -1.0f,  1.0f,   0.0f, 1.0f,
-    -1.0f, -1.0f,   0.0f, 0.0f,
-     1.0f, -1.0f,   1.0f, 0.0f,
-
-    -1.0f,  1.0f,   0.0f, 1.0f,
-     1.0f, -1.0f,   1.0f, 0.0f,
-     1.0f,  1.0f,   1.0f, 1.0f
+// TAA resolve workgroup size, must match TILE_SIZE in taa_resolve_compute.glsl
+static const int TAA_TILE_SIZE = 8;
+// TAA history sample cap, must match taa_resolve_compute.glsl
+static const int TAA_MAX_SAMPLES = 128;
+// a pixel stops receiving adaptive samples once the variance of its mean luminance drops below this
+static const float ADAPTIVE_VARIANCE_THRESHOLD = 2.5e-5f;
+// must match local_size_x in splat_cull_compute.glsl and the tile size of hiz_build_compute.glsl
+static const int CULL_GROUP_SIZE = 256;
+static const int HIZ_TILE_SIZE = 8;
+// larger view changes between two frames are treated as a camera cut, only frustum culling is done
+static const float HIZ_CUT_EPSILON = 0.25f;
+// programs and buffers of a render mode that has not been used for this long are freed
+static const std::chrono::seconds MODE_RELEASE_DELAY(10);
+// blue noise tile size, must be a power of two, the shader wraps with a mask
+static const uint32_t BLUE_NOISE_SIZE = 64;
+static const uint32_t BLUE_NOISE_SEED = 0x5eed;
+// overdraw histogram bins, one per fragment count, the last one counts everything above
+static const uint32_t OVERDRAW_HISTOGRAM_SIZE = 257;
+// fragment count shown red in the overdraw heatmap
+static const float OVERDRAW_MAX_COUNT = 128.0f;
+
+// the cpu vectors that seed gpu buffers, counted by the MemoryTracker while they exist
+struct SeedVectorBytes
+{
+    SeedVectorBytes(size_t bytesIn) : bytes(bytesIn) { MemoryTracker::Alloc(MemoryTracker::SortVectors, bytes); }
+    ~SeedVectorBytes() { MemoryTracker::Free(MemoryTracker::SortVectors, bytes); }
+    size_t bytes;
 };
 
+// 0, 1, 2 ... count - 1
+static std::vector<uint32_t> MakeIndexVec(size_t count)
+{
+    assert(count <= std::numeric_limits<uint32_t>::max());
+    std::vector<uint32_t> indexVec(count);
+    for (uint32_t i = 0; i < (uint32_t)count; i++)
+    {
+        indexVec[i] = i;
+    }
+    return indexVec;
+}
+
 static void SetupAttrib(int loc, const BinaryAttribute& attrib, int32_t count, size_t stride)
 {
     assert(attrib.type == BinaryAttribute::Type::Float);
@@ -56,49 +90,103 @@ static void SetupAttrib(int loc, const BinaryAttribute& attrib, int32_t count, s
     glEnableVertexAttribArray(loc);
 }
 
+static void SetupSplatAttribs(const std::shared_ptr<Program>& prog, const std::shared_ptr<GaussianCloud>& gaussianCloud)
+{
+    const size_t stride = gaussianCloud->GetStride();
+    SetupAttrib(prog->GetAttribLoc("position"), gaussianCloud->GetPosWithAlphaAttrib(), 4, stride);
+    SetupAttrib(prog->GetAttribLoc("r_sh0"), gaussianCloud->GetR_SH0Attrib(), 4, stride);
+    SetupAttrib(prog->GetAttribLoc("g_sh0"), gaussianCloud->GetG_SH0Attrib(), 4, stride);
+    SetupAttrib(prog->GetAttribLoc("b_sh0"), gaussianCloud->GetB_SH0Attrib(), 4, stride);
+    if (gaussianCloud->HasFullSH())
+    {
+        SetupAttrib(prog->GetAttribLoc("r_sh1"), gaussianCloud->GetR_SH1Attrib(), 4, stride);
+        SetupAttrib(prog->GetAttribLoc("r_sh2"), gaussianCloud->GetR_SH2Attrib(), 4, stride);
+        SetupAttrib(prog->GetAttribLoc("r_sh3"), gaussianCloud->GetR_SH3Attrib(), 4, stride);
+        SetupAttrib(prog->GetAttribLoc("g_sh1"), gaussianCloud->GetG_SH1Attrib(), 4, stride);
+        SetupAttrib(prog->GetAttribLoc("g_sh2"), gaussianCloud->GetG_SH2Attrib(), 4, stride);
+        SetupAttrib(prog->GetAttribLoc("g_sh3"), gaussianCloud->GetG_SH3Attrib(), 4, stride);
+        SetupAttrib(prog->GetAttribLoc("b_sh1"), gaussianCloud->GetB_SH1Attrib(), 4, stride);
+        SetupAttrib(prog->GetAttribLoc("b_sh2"), gaussianCloud->GetB_SH2Attrib(), 4, stride);
+        SetupAttrib(prog->GetAttribLoc("b_sh3"), gaussianCloud->GetB_SH3Attrib(), 4, stride);
+    }
+    SetupAttrib(prog->GetAttribLoc("cov3_col0"), gaussianCloud->GetCov3_Col0Attrib(), 3, stride);
+    SetupAttrib(prog->GetAttribLoc("cov3_col1"), gaussianCloud->GetCov3_Col1Attrib(), 3, stride);
+    SetupAttrib(prog->GetAttribLoc("cov3_col2"), gaussianCloud->GetCov3_Col2Attrib(), 3, stride);
+}
+
+bool matricesNotEqual(const glm::mat4& a, const glm::mat4& b,
+    float epsilon = 1e-2f) {
+        for (int i = 0; i < 4; ++i) {
+            if (!glm::all(glm::lessThan(glm::abs(a[i] - b[i]), glm::vec4(epsilon))))
+                return true;
+        }
+        return false;
+}
+
 SplatRenderer::SplatRenderer()
 {
 }
 
 SplatRenderer::~SplatRenderer()
 {
+    if (overdrawVAO) {
+        glDeleteVertexArrays(1, &overdrawVAO);
+    }
 }
 
-bool SplatRenderer::LoadShader(std::string renderMode, bool useMultiRadixSort)
+bool SplatRenderer::LoadShader(ModePrograms& mp)
 {
-    if (renderMode == "AB"){
-        if (!splatProg->LoadVertGeomFrag("shader/splat_vert.glsl", 
-            "shader/splat_geom.glsl", "shader/splat_frag.glsl"))
+    mp.splatProg = std::make_shared<Program>();
+    if (hybrid) {
+        mp.nearSplatProg = std::make_shared<Program>();
+    }
+
+    // only the first DEFINES macro is expanded, so all of them go into one string
+    bool useSampleMask = renderMode != "AB" && sampleMaskCount > 1;
+    if (isFramebufferSRGBEnabled || gaussianCloud->HasFullSH() || useSampleMask || hiz || subsample || overdraw)
+    {
+        std::string defines = "";
+        if (isFramebufferSRGBEnabled)
         {
-            Log::E("Error loading splat shaders!\n");
-            return false;
+            defines += "#define FRAMEBUFFER_SRGB\n";
         }
-
-        preSortProg = std::make_shared<Program>();
-        if (!preSortProg->LoadCompute("shader/presort_compute.glsl"))
+        if (gaussianCloud->HasFullSH())
         {
-            Log::E("Error loading pre-sort compute shader!\n");
-            return false;
+            defines += "#define FULL_SH\n";
         }
-
-        if (useMultiRadixSort)
+        if (overdraw)
         {
-            sortProg = std::make_shared<Program>();
-            if (!sortProg->LoadCompute("shader/multi_radixsort.glsl"))
-            {
-                Log::E("Error loading sort compute shader!\n");
-                return false;
-            }
+            defines += "#define OVERDRAW\n";
+        }
+        if (mp.nearSplatProg)
+        {
+            mp.nearSplatProg->AddMacro("DEFINES", defines);
+        }
+        if (useSampleMask)
+        {
+            // one fragment per pixel writes a stochastic coverage mask over all MSAA samples
+            defines += "#define SAMPLE_MASK\n#define NUM_SAMPLES " + std::to_string(sampleMaskCount) + "\n";
+        }
+        if (hiz)
+        {
+            defines += "#define HIZ\n";
+        }
+        if (subsample)
+        {
+            defines += "#define SUBSAMPLE\n";
+        }
+        mp.splatProg->AddMacro("DEFINES", defines);
+    }
 
-            histogramProg = std::make_shared<Program>();
-            if (!histogramProg->LoadCompute("shader/multi_radixsort_histograms.glsl"))
-            {
-                Log::E("Error loading histogram compute shader!\n");
-                return false;
-            }
+    if (renderMode == "AB"){
+        if (!mp.splatProg->LoadVertGeomFrag("shader/splat_vert.glsl", 
+            "shader/splat_geom.glsl", "shader/splat_frag.glsl"))
+        {
+            Log::E("Error loading splat shaders!\n");
+            return false;
         }
-    }  else if (renderMode == "ST") {
-        if (!splatProg->LoadVertGeomFrag("shader/splat_vert.glsl",
+    }  else if (renderMode == "ST" || renderMode == "hybrid") {
+        if (!mp.splatProg->LoadVertGeomFrag("shader/splat_vert.glsl",
           "shader/splat_geom.glsl",
           "shader/splat_frag_ST.glsl")) {
           Log::E("Error loading splat shaders!\n");
@@ -106,133 +194,337 @@ bool SplatRenderer::LoadShader(std::string renderMode, bool useMultiRadixSort)
         }
       }
       else if (renderMode == "ST-popfree") {
-        if (!splatProg->LoadVertGeomFrag("shader/splat_vert_ST_popfree.glsl",
+        if (!mp.splatProg->LoadVertGeomFrag("shader/splat_vert_ST_popfree.glsl",
           "shader/splat_geom_ST_popfree.glsl",
           "shader/splat_frag_ST.glsl")) {
           Log::E("Error loading splat shaders!\n");
           return false;
         }
       }
-      if (renderMode != "AB" && taa) {
-        // warp the previous average frame to current view
-        warpProg = std::make_shared<Program>();
-        if (!warpProg->LoadVertFrag("shader/warp_vert.glsl",
-                                   "shader/warp_frag.glsl")) {
-          Log::E("Error loading warp shader!\n");
-          return false;
-        }
-        // average over the previous frame average and the current one
-        avgProg = std::make_shared<Program>();
-        if (!avgProg->LoadVertFrag("shader/avg_vert.glsl", 
-                                   "shader/avg_frag.glsl")) {
-            Log::E("Error loading avg shader!\n");
+
+    if (hybrid) {
+        if (!mp.nearSplatProg->LoadVertGeomFrag("shader/splat_vert.glsl",
+            "shader/splat_geom.glsl", "shader/splat_frag.glsl"))
+        {
+            Log::E("Error loading near splat shaders!\n");
             return false;
         }
-        // display the final result
-        displayProg = std::make_shared<Program>();
-        if (!displayProg->LoadVertFrag("shader/avg_vert.glsl", 
-                                       "shader/display_frag.glsl")) {
-            Log::E("Error loading display shader!\n");
+    }
+
+    if (useDepthSort) {
+        mp.preSortProg = std::make_shared<Program>();
+        if (hybrid) {
+            mp.preSortProg->AddMacro("DEFINES", "#define HYBRID\n");
+        }
+        if (!mp.preSortProg->LoadCompute("shader/presort_compute.glsl"))
+        {
+            Log::E("Error loading pre-sort compute shader!\n");
             return false;
         }
-      }
+    }
     return true;
 }
 
-bool SplatRenderer::Init(std::shared_ptr<GaussianCloud> gaussianCloud,
+bool SplatRenderer::Init(std::shared_ptr<GaussianCloud> gaussianCloudIn,
                          bool isFramebufferSRGBEnabledIn, bool useRgcSortOverrideIn,
-                         std::string inrenderMode, int ineyeCount, int inwidth, int inheight, bool intaa)
+                         std::string inrenderMode, int ineyeCount, int inwidth, int inheight, bool intaa,
+                         bool incompactTaa, int inadaptivePasses, int insampleMaskCount, bool inhiz,
+                         uint32_t insplatBudget)
 {
     ZoneScopedNC("SplatRenderer::Init()", tracy::Color::Blue);
     GL_ERROR_CHECK("SplatRenderer::Init() begin");
 
     // Initialize member variables
+    gaussianCloud = gaussianCloudIn;
     isFramebufferSRGBEnabled = isFramebufferSRGBEnabledIn;
     useRgcSortOverride = useRgcSortOverrideIn;
-    bool useMultiRadixSort = GLEW_KHR_shader_subgroup && !useRgcSortOverride;
     numGaussians = gaussianCloud->GetNumGaussians();
-    renderMode = inrenderMode;
     width = inwidth;
     height = inheight;
     taa = intaa;
+    compactTaa = incompactTaa;
+    adaptivePasses = intaa ? inadaptivePasses : 0;
+    // the occluder depth comes from the TAA scene pass, hybrid already culls in the presort
+    hizRequested = inhiz && intaa;
+    // skipped splats are only made up for by the temporal accumulation
+    subsampleRequested = insplatBudget > 0 && intaa;
+    splatBudget = insplatBudget;
+    sampleMaskCount = insampleMaskCount;
     m_eyeCount = ineyeCount;
 
-    splatProg = std::make_shared<Program>();
-    
-    if (isFramebufferSRGBEnabled || gaussianCloud->HasFullSH())
+    // the scene is uploaded once, every render mode draws from the same buffers
     {
-        std::string defines = "";
-        if (isFramebufferSRGBEnabled)
-        {
-            defines += "#define FRAMEBUFFER_SRGB\n";
-        }
-        if (gaussianCloud->HasFullSH())
-        {
-            defines += "#define FULL_SH\n";
+        StartupReport::Phase phase("splat upload");
+        if (!BuildSplatBuffers()) {
+            return false;
         }
-        splatProg->AddMacro("DEFINES", defines);
     }
 
-    // Load shaders
-    if (!LoadShader(renderMode, useMultiRadixSort)) {
+    viewUniforms = std::make_shared<ViewUniforms>();
+    if (!viewUniforms->Init()) {
+        Log::E("ViewUniforms Init failed\n");
         return false;
     }
 
-    if (renderMode == "AB") {
-        // Build position vector for depth sorting
-        posVec.reserve(numGaussians);
-        gaussianCloud->ForEachPosWithAlpha([this](const float* pos)
-        {
-            posVec.emplace_back(glm::vec4(pos[0], pos[1], pos[2], 1.0f));
-        });
-        depthVec.resize(numGaussians);
-    } else if (taa) {
-        if (!InitializeTAA()) {
-            return false;
+    if (!SetRenderMode(inrenderMode)) {
+        return false;
+    }
+
+    GL_ERROR_CHECK("SplatRenderer::Init() end");
+    return true;
+}
+
+bool SplatRenderer::SetRenderMode(const std::string& mode)
+{
+    if (splatProg && mode == renderMode) {
+        return true;
+    }
+
+    ZoneScopedNC("SplatRenderer::SetRenderMode()", tracy::Color::Blue);
+    GL_ERROR_CHECK("SplatRenderer::SetRenderMode() begin");
+
+    std::string prevMode = splatProg ? renderMode : "";
+    renderMode = mode;
+    hybrid = renderMode == "hybrid";
+    useDepthSort = renderMode == "AB" || hybrid;
+    hiz = hizRequested && (renderMode == "ST" || renderMode == "ST-popfree");
+    subsample = subsampleRequested && (renderMode == "ST" || renderMode == "ST-popfree");
+    cullSplats = hiz || subsample;
+
+    // before the VAOs are built, they draw from the index buffer of the sort or the culling pass
+    bool ok = true;
+    if (renderMode != "AB") {
+        ok = InitializeNoise();
+    }
+    if (ok && useDepthSort) {
+        ok = InitializeSortingBuffers();
+    }
+    if (ok && renderMode != "AB" && taa) {
+        ok = InitializeTAA();
+    }
+    auto iter = modeCache.find(renderMode);
+    if (ok && iter == modeCache.end()) {
+        ModePrograms mp;
+        ok = LoadShader(mp);
+        if (ok) {
+            BuildVertexArrayObject(mp);
+            iter = modeCache.emplace(renderMode, mp).first;
         }
     }
+    if (!ok) {
+        Log::E("Error initializing render mode %s!\n", mode.c_str());
+        if (!prevMode.empty()) {
+            SetRenderMode(prevMode);
+        }
+        return false;
+    }
 
-    // Build vertex array object
-    BuildVertexArrayObject(gaussianCloud);
+    const ModePrograms& mp = iter->second;
+    splatProg = mp.splatProg;
+    splatVao = mp.splatVao;
+    nearSplatProg = mp.nearSplatProg;
+    nearSplatVao = mp.nearSplatVao;
+    preSortProg = mp.preSortProg;
 
-    // Initialize sorting buffers for alpha blending mode
-    if (renderMode == "AB") {
-        if (!InitializeSortingBuffers(useMultiRadixSort)) {
-            return false;
+    // the history of another mode would bleed into the new image
+    staticFrameCount = 0;
+    if (renderMode != "AB" && taa) {
+        int prevEye = activeEye;
+        for (activeEye = 0; activeEye < m_eyeCount; ++activeEye) {
+            resetTemporalTextures();
         }
+        activeEye = prevEye;
     }
+    ReleaseUnusedResources();
 
-    GL_ERROR_CHECK("SplatRenderer::Init() end");
+    Log::I("render mode %s\n", renderMode.c_str());
+    GL_ERROR_CHECK("SplatRenderer::SetRenderMode() end");
+    return true;
+}
+
+void SplatRenderer::ReleaseUnusedResources()
+{
+    auto now = std::chrono::steady_clock::now();
+    modeCache[renderMode].lastUsed = now;
+    if (useDepthSort) {
+        sortLastUsed = now;
+    }
+    if (renderMode != "AB" && taa) {
+        taaLastUsed = now;
+    }
+
+    for (auto iter = modeCache.begin(); iter != modeCache.end();) {
+        if (iter->first != renderMode && now - iter->second.lastUsed > MODE_RELEASE_DELAY) {
+            Log::D("releasing %s programs\n", iter->first.c_str());
+            iter = modeCache.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    if (!useDepthSort && posBuffer && now - sortLastUsed > MODE_RELEASE_DELAY) {
+        ReleaseSortingBuffers();
+    }
+    if (renderMode == "AB" && !eyeTextures.empty() && now - taaLastUsed > MODE_RELEASE_DELAY) {
+        ReleaseTAA();
+    }
+}
+
+void SplatRenderer::ReleaseSortingBuffers()
+{
+    Log::D("releasing sorting buffers\n");
+    keyBuffer.reset();
+    keyBuffer2.reset();
+    histogramBuffer.reset();
+    valBuffer.reset();
+    valBuffer2.reset();
+    posBuffer.reset();
+    atomicCounterBuffer.reset();
+    farIndexBuffer.reset();
+    sortedIndexBuffer.reset();
+    sorter.reset();
+    sortProg.reset();
+    histogramProg.reset();
+}
+
+void SplatRenderer::ReleaseTAA()
+{
+    Log::D("releasing taa buffers\n");
+    eyeTextures.clear();
+    resolveProg.reset();
+    stencilMaskProg.reset();
+    hizBuildProg.reset();
+    cullProg.reset();
+    drawCommandBuffer.reset();
+    culledIndexBuffer.reset();
+    std::vector<float>().swap(sortedAlphaVec);
+    std::vector<double>().swap(alphaSuffixSumVec);
+    if (fullscreenVAO) {
+        glDeleteVertexArrays(1, &fullscreenVAO);
+        fullscreenVAO = 0;
+    }
+}
+
+bool SplatRenderer::InitializeNoise()
+{
+    if (blueNoiseTex) {
+        return true;
+    }
+    ZoneScopedNC("InitializeNoise", tracy::Color::Blue);
+
+    noiseFrameIndex.assign(m_eyeCount, 0);
+
+    Texture::Params texParams;
+    texParams.magFilter = FilterType::Nearest;
+    texParams.minFilter = FilterType::Nearest;
+    texParams.sWrap = WrapType::Repeat;
+    texParams.tWrap = WrapType::Repeat;
+    blueNoiseTex = std::make_shared<Texture>(BLUE_NOISE_SIZE, BLUE_NOISE_SIZE, GL_R8, GL_RED, GL_UNSIGNED_BYTE, texParams);
+
+    std::vector<uint8_t> noise = GenerateBlueNoise(BLUE_NOISE_SIZE, BLUE_NOISE_SEED);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, BLUE_NOISE_SIZE, BLUE_NOISE_SIZE, GL_RED, GL_UNSIGNED_BYTE, noise.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GL_ERROR_CHECK("SplatRenderer::InitializeNoise()");
     return true;
 }
 
 bool SplatRenderer::InitializeTAA()
 {
+    // shared by all stochastic modes, the caller clears the history
+    if (!eyeTextures.empty()) {
+        return true;
+    }
+    ZoneScopedNC("InitializeTAA", tracy::Color::Blue);
+
+    // reproject the previous average into the current view, blend in the new frame
+    // and write the image that gets presented, all in one dispatch
+    resolveProg = std::make_shared<Program>();
+    std::string defines;
+    if (compactTaa) {
+        defines += "#define COMPACT_TAA\n";
+    }
+    if (adaptivePasses > 0) {
+        defines += "#define ADAPTIVE_SAMPLES\n";
+    }
+    resolveProg->AddMacro("DEFINES", defines);
+    if (!resolveProg->LoadCompute("shader/taa_resolve_compute.glsl")) {
+        Log::E("Error loading taa resolve compute shader!\n");
+        return false;
+    }
+    if (adaptivePasses > 0) {
+        // marks the pixels that get extra samples in the stencil buffer
+        stencilMaskProg = std::make_shared<Program>();
+        if (!stencilMaskProg->LoadVertFrag("shader/stencil_mask_vert.glsl",
+                                           "shader/stencil_mask_frag.glsl")) {
+            Log::E("Error loading stencil mask shader!\n");
+            return false;
+        }
+    }
+    if (hizRequested) {
+        hizBuildProg = std::make_shared<Program>();
+        if (!hizBuildProg->LoadCompute("shader/hiz_build_compute.glsl")) {
+            Log::E("Error loading hiz build compute shader!\n");
+            return false;
+        }
+    }
+    if (hizRequested || subsampleRequested) {
+        cullProg = std::make_shared<Program>();
+        std::string cullDefines;
+        if (hizRequested) {
+            cullDefines += "#define HIZ\n";
+        }
+        if (subsampleRequested) {
+            cullDefines += "#define SUBSAMPLE\n";
+        }
+        cullProg->AddMacro("DEFINES", cullDefines);
+        if (!cullProg->LoadCompute("shader/splat_cull_compute.glsl")) {
+            Log::E("Error loading splat cull compute shader!\n");
+            return false;
+        }
+
+        // count, instanceCount, firstIndex, baseVertex, baseInstance
+        drawCommandVec = {0, 1, 0, 0, 0};
+        drawCommandBuffer = std::make_shared<BufferObject>(GL_DRAW_INDIRECT_BUFFER, drawCommandVec, GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
+        // the selected indices, creating it binds GL_ELEMENT_ARRAY_BUFFER, keep it out of any VAO
+        glBindVertexArray(0);
+        SeedVectorBytes seedBytes(numGaussians * sizeof(uint32_t));
+        culledIndexBuffer = std::make_shared<BufferObject>(GL_ELEMENT_ARRAY_BUFFER, MakeIndexVec(numGaussians), GL_DYNAMIC_STORAGE_BIT);
+    }
+    if (subsampleRequested) {
+        sortedAlphaVec.reserve(numGaussians);
+        bool fetched = gaussianCloud->ForEachPosWithAlpha([this](const float* pos)
+        {
+            sortedAlphaVec.push_back(pos[3]);
+        });
+        if (!fetched) {
+            std::vector<float>().swap(sortedAlphaVec);
+            return false;
+        }
+        std::sort(sortedAlphaVec.begin(), sortedAlphaVec.end());
+        alphaSuffixSumVec.resize(sortedAlphaVec.size() + 1);
+        alphaSuffixSumVec.back() = 0.0;
+        for (size_t i = sortedAlphaVec.size(); i > 0; i--) {
+            alphaSuffixSumVec[i - 1] = alphaSuffixSumVec[i] + sortedAlphaVec[i - 1];
+        }
+        SetSplatBudget(splatBudget);
+    }
+
     Texture::Params texParams;
     texParams.magFilter = FilterType::Nearest;
     texParams.minFilter = FilterType::Nearest;
     texParams.sWrap = WrapType::ClampToEdge;
     texParams.tWrap = WrapType::ClampToEdge;
 
-    // Initialize quad geometry
-    glGenVertexArrays(1, &quadVAO);
-    glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-
     if (!CreateTAATextureBuffers(texParams)) {
+        eyeTextures.clear();
         return false;
     }
 
-    for (activeEye = 0; activeEye < m_eyeCount; ++activeEye) {
-        resetTemporalTextures();
+    if (adaptivePasses > 0) {
+        // the stencil mask pass draws a fullscreen triangle from gl_VertexID
+        glGenVertexArrays(1, &fullscreenVAO);
     }
-    activeEye = 0;
 
     return true;
 }
@@ -244,55 +536,160 @@ bool SplatRenderer::CreateTAATextureBuffers(const Texture::Params& texParams)
     eyeState.resize(m_eyeCount);
 
     for (int eye = 0; eye < m_eyeCount; eye++) {
-        // Create temporal accumulation textures
-        eyeTextures[eye].warpXYZTexA = std::make_shared<Texture>(
-            width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, texParams);
-        eyeTextures[eye].warpAvgTexA = std::make_shared<Texture>(
-            width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, texParams);
-        eyeTextures[eye].warpXYZTexB = std::make_shared<Texture>(
-            width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, texParams);
-        eyeTextures[eye].warpAvgTexB = std::make_shared<Texture>(
-            width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, texParams);
-                
-        // Create per-eye scene textures
-        eyeTextures[eye].currentFrameTex = std::make_shared<Texture>(
-            width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, texParams);
-        eyeTextures[eye].depthTex = std::make_shared<Texture>(
-            width, height, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, texParams);
-
-        // Create per-eye scene FBO
-        eyeTextures[eye].sceneFBO = std::make_shared<FrameBuffer>();
-        eyeTextures[eye].sceneFBO->Bind();
-        eyeTextures[eye].sceneFBO->AttachColor(eyeTextures[eye].currentFrameTex, GL_COLOR_ATTACHMENT0);
-        eyeTextures[eye].sceneFBO->AttachDepth(eyeTextures[eye].depthTex);
-
-        if (!eyeTextures[eye].sceneFBO->IsComplete()) {
+        if (!CreateEyeTemporalTextures(eyeTextures[eye], width, height, texParams)) {
             Log::E("eyeTextures[%d].sceneFBO is not complete!\n", eye);
             return false;
         }
     }
 
-    // Create FBOs for temporal accumulation
-    sumFBO = std::make_shared<FrameBuffer>();
-    
-    // Initialize FBOs with first eye's textures (will be updated per-eye)
-    sumFBO->Bind();
-    sumFBO->AttachColor(eyeTextures[0].warpAvgTexB, GL_COLOR_ATTACHMENT0);
-    sumFBO->AttachColor(eyeTextures[0].warpXYZTexB, GL_COLOR_ATTACHMENT1);
-    
     return true;
 }
 
-bool SplatRenderer::InitializeSortingBuffers(bool useMultiRadixSort)
+bool SplatRenderer::CreateEyeTemporalTextures(EyeTemporalTextures& T, int w, int h, const Texture::Params& texParams)
 {
-    depthVec.resize(numGaussians);
+    auto makeRGBA32F = [&]() {
+        return std::make_shared<Texture>(w, h, GL_RGBA32F, GL_RGBA, GL_FLOAT, texParams);
+    };
+
+    // the history color is gathered with a single bilinear fetch
+    Texture::Params historyParams = texParams;
+    historyParams.magFilter = FilterType::Linear;
+    historyParams.minFilter = FilterType::Linear;
+
+    if (compactTaa) {
+        // history color in rgb, accumulated sample count in alpha (exact in fp16 up to 2048)
+        T.warpAvgTexA = std::make_shared<Texture>(w, h, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, historyParams);
+        T.warpAvgTexB = std::make_shared<Texture>(w, h, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, historyParams);
+        // eye depth of the history, world position is reconstructed from it
+        T.warpDepthTexA = std::make_shared<Texture>(w, h, GL_R32F, GL_RED, GL_FLOAT, texParams);
+        T.warpDepthTexB = std::make_shared<Texture>(w, h, GL_R32F, GL_RED, GL_FLOAT, texParams);
+        T.warpXYZTexA.reset();
+        T.warpXYZTexB.reset();
+        // stochastic splats are opaque, so the current frame does not need alpha
+        T.currentFrameTex = std::make_shared<Texture>(w, h, GL_R11F_G11F_B10F, GL_RGB, GL_FLOAT, texParams);
+    } else {
+        // Create temporal accumulation textures
+        T.warpXYZTexA = makeRGBA32F();
+        T.warpAvgTexA = std::make_shared<Texture>(w, h, GL_RGBA32F, GL_RGBA, GL_FLOAT, historyParams);
+        T.warpXYZTexB = makeRGBA32F();
+        T.warpAvgTexB = std::make_shared<Texture>(w, h, GL_RGBA32F, GL_RGBA, GL_FLOAT, historyParams);
+        T.currentFrameTex = makeRGBA32F();
+    }
+
+    if (adaptivePasses > 0) {
+        // running mean of the squared luminance, for the per pixel variance
+        T.momentTexA = std::make_shared<Texture>(w, h, GL_R32F, GL_RED, GL_FLOAT, historyParams);
+        T.momentTexB = std::make_shared<Texture>(w, h, GL_R32F, GL_RED, GL_FLOAT, historyParams);
+        T.depthTex = std::make_shared<Texture>(w, h, GL_DEPTH32F_STENCIL8, GL_DEPTH_STENCIL,
+                                               GL_FLOAT_32_UNSIGNED_INT_24_8_REV, texParams);
+    } else {
+        T.depthTex = std::make_shared<Texture>(w, h, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, texParams);
+    }
+
+    // Create per-eye scene FBO
+    T.sceneFBO = std::make_shared<FrameBuffer>();
+    T.sceneFBO->Bind();
+    T.sceneFBO->AttachColor(T.currentFrameTex, GL_COLOR_ATTACHMENT0);
+    T.sceneFBO->AttachDepth(T.depthTex);
+    if (adaptivePasses > 0) {
+        T.sceneFBO->AttachStencil(T.depthTex);
+    }
+    if (hizRequested) {
+        // base level is the occluder output of the splat shader, the rest is built from it.
+        // Allocated for every stochastic mode so they can share the textures, only ST and
+        // ST-popfree write it.
+        Texture::Params hizParams = texParams;
+        hizParams.minFilter = FilterType::NearestMipmapNearest;
+        T.hizTex = std::make_shared<Texture>(w, h, GL_R32F, GL_RED, GL_FLOAT, hizParams);
+        T.hizLevels = 1;
+        for (int mw = w, mh = h; mw > 1 || mh > 1; T.hizLevels++) {
+            mw = std::max(mw / 2, 1);
+            mh = std::max(mh / 2, 1);
+            glTexImage2D(GL_TEXTURE_2D, T.hizLevels, GL_R32F, mw, mh, 0, GL_RED, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, T.hizLevels - 1);
+
+        // attached directly, FrameBuffer only tracks one color attachment
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, T.hizTex->GetObj(), 0);
+        const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, drawBuffers);
+    }
+    if (!T.sceneFBO->IsComplete()) {
+        return false;
+    }
+
+    // read framebuffers used to blit the resolved history to the present target
+    T.historyFBOA = std::make_shared<FrameBuffer>();
+    T.historyFBOA->Bind();
+    T.historyFBOA->AttachColor(T.warpAvgTexA, GL_COLOR_ATTACHMENT0);
+    T.historyFBOB = std::make_shared<FrameBuffer>();
+    T.historyFBOB->Bind();
+    T.historyFBOB->AttachColor(T.warpAvgTexB, GL_COLOR_ATTACHMENT0);
+
+    return T.historyFBOA->IsComplete() && T.historyFBOB->IsComplete();
+}
+
+bool SplatRenderer::InitializeSortingBuffers()
+{
+    if (hybrid && !farIndexBuffer)
+    {
+        // unsorted far splat indices, copied behind the sorted near ones
+        SeedVectorBytes seedBytes(numGaussians * sizeof(uint32_t));
+        farIndexBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, MakeIndexVec(numGaussians), GL_DYNAMIC_STORAGE_BIT);
+    }
+    // shared by AB and hybrid
+    if (posBuffer)
+    {
+        return true;
+    }
+    ZoneScopedNC("InitializeSortingBuffers", tracy::Color::Blue);
 
+    bool useMultiRadixSort = GLEW_KHR_shader_subgroup && !useRgcSortOverride;
     if (useMultiRadixSort)
     {
         Log::I("using multi_radixsort.glsl\n");
 
-        keyBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, depthVec, GL_DYNAMIC_STORAGE_BIT);
+        sortProg = std::make_shared<Program>();
+        if (!sortProg->LoadCompute("shader/multi_radixsort.glsl"))
+        {
+            Log::E("Error loading sort compute shader!\n");
+            return false;
+        }
+
+        histogramProg = std::make_shared<Program>();
+        if (!histogramProg->LoadCompute("shader/multi_radixsort_histograms.glsl"))
+        {
+            Log::E("Error loading histogram compute shader!\n");
+            return false;
+        }
+    }
+    else
+    {
+        Log::I("using rgc::radix_sort\n");
+        sorter = std::make_shared<rgc::radix_sort::sorter>(numGaussians);
+    }
+
+    // positions for depth sorting, these only live until they are uploaded
+    SeedVectorBytes seedBytes(numGaussians * (sizeof(glm::vec4) + 2 * sizeof(uint32_t)));
+    std::vector<glm::vec4> posVec;
+    posVec.reserve(numGaussians);
+    bool fetched = gaussianCloud->ForEachPosWithAlpha([&posVec](const float* pos)
+    {
+        posVec.emplace_back(glm::vec4(pos[0], pos[1], pos[2], 1.0f));
+    });
+    if (!fetched)
+    {
+        return false;
+    }
+    std::vector<uint32_t> depthVec(numGaussians, 0);
+    std::vector<uint32_t> indexVec = MakeIndexVec(numGaussians);
+
+    keyBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, depthVec, GL_DYNAMIC_STORAGE_BIT);
+    valBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, indexVec, GL_DYNAMIC_STORAGE_BIT);
+    if (useMultiRadixSort)
+    {
         keyBuffer2 = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, depthVec, GL_DYNAMIC_STORAGE_BIT);
+        valBuffer2 = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, indexVec, GL_DYNAMIC_STORAGE_BIT);
 
         const uint32_t NUM_ELEMENTS = static_cast<uint32_t>(numGaussians);
         const uint32_t NUM_WORKGROUPS = (NUM_ELEMENTS + numBlocksPerWorkgroup - 1) / numBlocksPerWorkgroup;
@@ -300,36 +697,30 @@ bool SplatRenderer::InitializeSortingBuffers(bool useMultiRadixSort)
 
         std::vector<uint32_t> histogramVec(NUM_WORKGROUPS * RADIX_SORT_BINS, 0);
         histogramBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, histogramVec, GL_DYNAMIC_STORAGE_BIT);
-
-        valBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, indexVec, GL_DYNAMIC_STORAGE_BIT);
-        valBuffer2 = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, indexVec, GL_DYNAMIC_STORAGE_BIT);
-        posBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, posVec);
-    }
-    else
-    {
-        Log::I("using rgc::radix_sort\n");
-        keyBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, depthVec, GL_DYNAMIC_STORAGE_BIT);
-        valBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, indexVec, GL_DYNAMIC_STORAGE_BIT);
-        posBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, posVec);
-
-        sorter = std::make_shared<rgc::radix_sort::sorter>(numGaussians);
     }
+    posBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, posVec);
+    // Sort() overwrites the front of it each frame. Creating it binds GL_ELEMENT_ARRAY_BUFFER, keep
+    // it out of any VAO
+    glBindVertexArray(0);
+    sortedIndexBuffer = std::make_shared<BufferObject>(GL_ELEMENT_ARRAY_BUFFER, indexVec, GL_DYNAMIC_STORAGE_BIT);
 
-    atomicCounterVec.resize(1, 0);
+    // sorted count, plus the far count in hybrid mode
+    atomicCounterVec.resize(2, 0);
     atomicCounterBuffer = std::make_shared<BufferObject>(GL_ATOMIC_COUNTER_BUFFER, atomicCounterVec, GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
-    
+
     return true;
 }
 
 void SplatRenderer::Sort(const glm::mat4& cameraMat, const glm::mat4& projMat,
                          const glm::vec2& nearFar)
 {
-    if (renderMode != "AB")   return;
+    if (!useDepthSort)   return;
 
     ZoneScoped;
+    GpuProfiler::Zone sortZone(gpuProfiler.get(), "sort");
     GL_ERROR_CHECK("SplatRenderer::Sort() begin");
 
-    const size_t numPoints = posVec.size();
+    const size_t numPoints = numGaussians;
     glm::mat4 modelViewMat = glm::inverse(cameraMat);
 
     bool useMultiRadixSort = GLEW_KHR_shader_subgroup && !useRgcSortOverride;
@@ -342,19 +733,25 @@ void SplatRenderer::Sort(const glm::mat4& cameraMat, const glm::mat4& projMat,
 
     {
         ZoneScopedNC("pre-sort", tracy::Color::Red4);
+        GpuProfiler::Zone gpuZone(gpuProfiler.get(), "pre-sort");
 
         preSortProg->Bind();
-        preSortProg->SetUniform("modelViewProj", projMat * modelViewMat);
-        preSortProg->SetUniform("nearFar", nearFar);
-        preSortProg->SetUniform("keyMax", MAX_DEPTH);
+        preSortProg->SetUniform(preSortUniforms.modelViewProj, projMat * modelViewMat);
+        // in hybrid mode only the near range is sorted, so the keys use it as their far plane
+        preSortProg->SetUniform(preSortUniforms.nearFar, hybrid ? glm::vec2(nearFar.x, hybridNearDepth) : nearFar);
+        preSortProg->SetUniform(preSortUniforms.keyMax, MAX_DEPTH);
 
-        // reset counter back to zero
-        atomicCounterVec[0] = 0;
+        // reset counters back to zero
+        std::fill(atomicCounterVec.begin(), atomicCounterVec.end(), 0);
         atomicCounterBuffer->Update(atomicCounterVec);
 
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, posBuffer->GetObj());  // readonly
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, keyBuffer->GetObj());  // writeonly
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, valBuffer->GetObj());  // writeonly
+        if (hybrid)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, farIndexBuffer->GetObj());  // writeonly
+        }
         glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 4, atomicCounterBuffer->GetObj());
 
         const int LOCAL_SIZE = 256;
@@ -366,11 +763,13 @@ void SplatRenderer::Sort(const glm::mat4& cameraMat, const glm::mat4& projMat,
 
     {
         ZoneScopedNC("get-count", tracy::Color::Green);
+        GpuProfiler::Zone gpuZone(gpuProfiler.get(), "get-count");
 
         atomicCounterBuffer->Read(atomicCounterVec);
         sortCount = atomicCounterVec[0];
+        farCount = hybrid ? atomicCounterVec[1] : 0;
 
-        assert(sortCount <= (uint32_t)numPoints);
+        assert(sortCount + farCount <= (uint32_t)numPoints);
 
         GL_ERROR_CHECK("SplatRenderer::Render() get-count");
     }
@@ -383,19 +782,22 @@ void SplatRenderer::Sort(const glm::mat4& cameraMat, const glm::mat4& projMat,
         const uint32_t NUM_WORKGROUPS = (NUM_ELEMENTS + numBlocksPerWorkgroup - 1) / numBlocksPerWorkgroup;
 
         sortProg->Bind();
-        sortProg->SetUniform("g_num_elements", NUM_ELEMENTS);
-        sortProg->SetUniform("g_num_workgroups", NUM_WORKGROUPS);
-        sortProg->SetUniform("g_num_blocks_per_workgroup", numBlocksPerWorkgroup);
+        sortProg->SetUniform(sortUniforms.numElements, NUM_ELEMENTS);
+        sortProg->SetUniform(sortUniforms.numWorkgroups, NUM_WORKGROUPS);
+        sortProg->SetUniform(sortUniforms.numBlocksPerWorkgroup, numBlocksPerWorkgroup);
 
         histogramProg->Bind();
-        histogramProg->SetUniform("g_num_elements", NUM_ELEMENTS);
-        //histogramProg->SetUniform("g_num_workgroups", NUM_WORKGROUPS);
-        histogramProg->SetUniform("g_num_blocks_per_workgroup", numBlocksPerWorkgroup);
+        histogramProg->SetUniform(histogramUniforms.numElements, NUM_ELEMENTS);
+        //histogramProg->SetUniform(histogramUniforms.numWorkgroups, NUM_WORKGROUPS);
+        histogramProg->SetUniform(histogramUniforms.numBlocksPerWorkgroup, numBlocksPerWorkgroup);
 
+        static const char* RADIX_PASS_NAMES[] = {"radix pass 0", "radix pass 1", "radix pass 2", "radix pass 3"};
         for (uint32_t i = 0; i < NUM_BYTES; i++)
         {
+            GpuProfiler::Zone gpuZone(gpuProfiler.get(), RADIX_PASS_NAMES[i]);
+
             histogramProg->Bind();
-            histogramProg->SetUniform("g_shift", 8 * i);
+            histogramProg->SetUniform(histogramUniforms.shift, 8 * i);
 
             if (i == 0 || i == 2)
             {
@@ -412,7 +814,7 @@ void SplatRenderer::Sort(const glm::mat4& cameraMat, const glm::mat4& projMat,
             glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
             sortProg->Bind();
-            sortProg->SetUniform("g_shift", 8 * i);
+            sortProg->SetUniform(sortUniforms.shift, 8 * i);
 
             if ((i % 2) == 0)  // even
             {
@@ -459,12 +861,14 @@ void SplatRenderer::Sort(const glm::mat4& cameraMat, const glm::mat4& projMat,
     else
     {
         ZoneScopedNC("sort", tracy::Color::Red4);
+        GpuProfiler::Zone gpuZone(gpuProfiler.get(), "radix sort");
         sorter->sort(keyBuffer->GetObj(), valBuffer->GetObj(), sortCount);
         GL_ERROR_CHECK("SplatRenderer::Sort() rgc sort");
     }
 
     {
         ZoneScopedNC("copy-sorted", tracy::Color::DarkGreen);
+        GpuProfiler::Zone gpuZone(gpuProfiler.get(), "copy-sorted");
 
         if (useMultiRadixSort && (NUM_BYTES % 2) == 1)  // odd
         {
@@ -477,6 +881,13 @@ void SplatRenderer::Sort(const glm::mat4& cameraMat, const glm::mat4& projMat,
         glBindBuffer(GL_COPY_WRITE_BUFFER, splatVao->GetElementBuffer()->GetObj());
         glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sortCount * sizeof(uint32_t));
 
+        if (hybrid && farCount > 0)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, farIndexBuffer->GetObj());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, sortCount * sizeof(uint32_t),
+                                farCount * sizeof(uint32_t));
+        }
+
         GL_ERROR_CHECK("SplatRenderer::Sort() copy-sorted");
     }
 }
@@ -486,34 +897,46 @@ void SplatRenderer::Render(const glm::mat4& cameraMat, const glm::mat4& projMat,
                            const glm::vec4& viewport, const glm::vec2& nearFar)
 {
     ZoneScoped;
+    GpuProfiler::Zone renderZone(gpuProfiler.get(), "render");
 
     GL_ERROR_CHECK("SplatRenderer::Render() begin");
 
+    ReleaseUnusedResources();
+
+    // everything drawn for this view reads its matrices from here
+    viewUniforms->Update(cameraMat, projMat, viewport, nearFar);
+
+    if (overdraw) {
+        BeginOverdraw(viewport);
+    }
+
     {
         glViewport((GLint)viewport.x, (GLint)viewport.y,
            (GLint)viewport.z, (GLint)viewport.w);
         
-        float width = viewport.z;
-        float height = viewport.w;
-        float aspectRatio = width / height;
-        glm::mat4 viewMat = glm::inverse(cameraMat);
-        glm::vec3 eye = glm::vec3(cameraMat[3]);
-        float multiplier = (nearFar.x - nearFar.y) * projMat[3][2];
+        const glm::mat4& viewMat = viewUniforms->GetBlock().viewMat;
 
-        splatProg->Bind();
-        splatProg->SetUniform("viewMat", viewMat);
-        splatProg->SetUniform("projMat", projMat);
-        splatProg->SetUniform("projParams", glm::vec3(width, height, multiplier));
-        splatProg->SetUniform("eye", eye);
+        glm::mat4 pvmat = projMat * viewMat;
+        if (matricesNotEqual(pvmat, lastPvmat, 1e-3f)) {
+            staticFrameCount = 0;
+        } else {
+            staticFrameCount++;
+        }
+        lastPvmat = pvmat;
 
+        splatProg->Bind();
         if (renderMode != "AB") {
-            uint32_t randomSeed = rand();
-            splatProg->SetUniform("u_randomSeed", randomSeed);
+            SetNoiseUniforms();
+        }
+        if (subsample) {
+            splatProg->SetUniform(splatUniforms.subsampleParams, subsampleParams);
         }
 
         splatVao->Bind();
         
         if (renderMode == "AB") {
+            GpuProfiler::Zone gpuZone(gpuProfiler.get(), "draw");
+            GpuProfiler::StatsRange statsRange(gpuProfiler.get());
             glDrawElements(GL_POINTS, sortCount, GL_UNSIGNED_INT, nullptr);
         }
         else {
@@ -529,14 +952,33 @@ void SplatRenderer::Render(const glm::mat4& cameraMat, const glm::mat4& projMat,
                 }
                 
                 currentEyeState.pvmat = projMat * viewMat;
+                currentEyeState.depthParams = glm::vec2(projMat[2][2], projMat[3][2]);
+                if (cullSplats) {
+                    CullSplats(currentEyeTextures, currentEyeState);
+                    splatProg->Bind();
+                }
                 // Use per-eye scene FBO for VR
                 currentEyeTextures.sceneFBO->Bind();
                 glViewport(0, 0, (GLint)viewport.z, (GLint)viewport.w);
                 glEnable(GL_DEPTH_TEST);
                 glDepthFunc(GL_LESS);
                 glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                if (hiz) {
+                    // no occluder until a fragment writes one
+                    static const GLfloat FAR_DEPTH[4] = {1.f, 1.f, 1.f, 1.f};
+                    glClearBufferfv(GL_COLOR, 1, FAR_DEPTH);
+                    // r32f is not blendable everywhere, the opaque splat output does not need it
+                    glDisable(GL_BLEND);
+                }
+            }
+            {
+                GpuProfiler::Zone gpuZone(gpuProfiler.get(), "draw");
+                GpuProfiler::StatsRange statsRange(gpuProfiler.get());
+                DrawStochasticSplats();
+            }
+            if (hiz) {
+                BuildHiZ(eyeTextures[activeEye]);
             }
-            glDrawElements(GL_POINTS, (GLsizei)numGaussians, GL_UNSIGNED_INT, nullptr);
 
         }
         splatVao->Unbind();
@@ -546,60 +988,411 @@ void SplatRenderer::Render(const glm::mat4& cameraMat, const glm::mat4& projMat,
     if (renderMode != "AB" && taa) {
         Average(viewport);
     }
+    if (hybrid) {
+        RenderNearSplats();
+    }
+    if (overdraw) {
+        DrawOverdrawHeatmap(viewport);
+    }
+}
+
+SplatRenderer::FrameStats SplatRenderer::ReadFrameStats()
+{
+    FrameStats stats;
+    stats.sortCount = useDepthSort ? sortCount : 0;
+    if (renderMode == "AB") {
+        stats.drawCount = sortCount;
+    } else if (cullSplats && taa) {
+        drawCommandBuffer->Read(drawCommandVec);
+        stats.drawCount = drawCommandVec[0];
+    } else if (hybrid) {
+        stats.drawCount = sortCount + farCount;
+    } else {
+        stats.drawCount = (uint32_t)numGaussians;
+    }
+    return stats;
+}
+
+void SplatRenderer::DrawStochasticSplats()
+{
+    if (cullSplats) {
+        // CullSplats() wrote the selected indices and their count
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBuffer->GetObj());
+        glDrawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    } else if (hybrid) {
+        // Sort() placed the far splats right behind the sorted near ones
+        glDrawElements(GL_POINTS, (GLsizei)farCount, GL_UNSIGNED_INT,
+                       (void*)(sortCount * sizeof(uint32_t)));
+    } else {
+        glDrawElements(GL_POINTS, (GLsizei)numGaussians, GL_UNSIGNED_INT, nullptr);
+    }
+}
+
+void SplatRenderer::CullSplats(const EyeTemporalTextures& T, const EyeTemporalState& S)
+{
+    ZoneScopedNC("cull splats", tracy::Color::Red4);
+    GpuProfiler::Zone gpuZone(gpuProfiler.get(), "cull");
+
+    drawCommandVec[0] = 0;
+    drawCommandBuffer->Update(drawCommandVec);
+
+    // the current view comes from viewUniforms
+    cullProg->Bind();
+    cullProg->SetUniform(cullUniforms.numSplats, (uint32_t)numGaussians);
+    cullProg->SetUniform(cullUniforms.splatStride, splatStride);
+    cullProg->SetUniform(cullUniforms.posOffset, posOffset);
+    cullProg->SetUniform(cullUniforms.cov0Offset, cov0Offset);
+    cullProg->SetUniform(cullUniforms.cov1Offset, cov1Offset);
+    cullProg->SetUniform(cullUniforms.cov2Offset, cov2Offset);
+    if (hiz) {
+        // the pyramid holds last frame's depth, it is only trusted for small view changes
+        bool occlusionTest = S.frameCount > 1 && !matricesNotEqual(S.pvmat, S.prev_pvmat, HIZ_CUT_EPSILON);
+        cullProg->SetUniform(cullUniforms.hizViewProjMat, S.prev_pvmat);
+        cullProg->SetUniform(cullUniforms.occlusionTest, occlusionTest);
+        cullProg->SetUniform(cullUniforms.hizMaxLevel, T.hizLevels - 1);
+        // unit 0 holds the blue noise of the splat draw that follows
+        bindTex2D(1, T.hizTex);
+        cullProg->SetUniform(cullUniforms.hizTexture, 1);
+    }
+    if (subsample) {
+        // a new subset every frame, the history averages over them
+        cullProg->SetUniform(cullUniforms.subsampleParams, subsampleParams);
+        cullProg->SetUniform(cullUniforms.frameSeed, (uint32_t)rand());
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gaussianDataBuffer->GetObj());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, splatVao->GetElementBuffer()->GetObj());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, drawCommandBuffer->GetObj());
+
+    glDispatchCompute(((GLuint)numGaussians + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    if (hiz) {
+        // level 0 is rendered to next, keep it out of the texture units
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    GL_ERROR_CHECK("SplatRenderer::CullSplats()");
+}
+
+void SplatRenderer::SetSplatBudget(uint32_t budget)
+{
+    if (!subsampleRequested) {
+        return;
+    }
+    // solved again from the opacities when the TAA resources are rebuilt
+    splatBudget = budget;
+    if (sortedAlphaVec.empty()) {
+        return;
+    }
+
+    // a splat is kept with probability p = min(1, k * max(alpha, s)) and drawn with alpha / p,
+    // so the expected coverage is unchanged as long as alpha / p <= 1. The floor s keeps faint
+    // splats from getting near zero probabilities and exploding weights.
+    double alphaSum = alphaSuffixSumVec[0];
+    if (budget == 0 || budget >= sortedAlphaVec.size()) {
+        subsampleParams = glm::vec2(1.0f, 1.0f);
+    } else if (alphaSum <= budget) {
+        // k = 1 is unbiased, search the floor that spends the budget: sum(max(alpha, s)) = budget
+        float lo = 0.0f, hi = 1.0f;
+        for (int i = 0; i < 24; i++) {
+            float s = 0.5f * (lo + hi);
+            // splats below s all count as s
+            size_t below = std::lower_bound(sortedAlphaVec.begin(), sortedAlphaVec.end(), s) - sortedAlphaVec.begin();
+            double expected = (double)below * s + alphaSuffixSumVec[below];
+            if (expected > budget) {
+                hi = s;
+            } else {
+                lo = s;
+            }
+        }
+        subsampleParams = glm::vec2(lo, 1.0f);
+    } else {
+        // even proportional to opacity the budget is exceeded, scale all probabilities down,
+        // opaque splats then reach at most alpha / p = 1 / k, the result gets more transparent
+        subsampleParams = glm::vec2(0.0f, (float)(budget / alphaSum));
+    }
+    Log::D("splat budget %u of %u, floor = %f, scale = %f\n", budget, (uint32_t)sortedAlphaVec.size(),
+           subsampleParams.x, subsampleParams.y);
+}
+
+void SplatRenderer::BuildHiZ(const EyeTemporalTextures& T)
+{
+    ZoneScopedNC("hiz build", tracy::Color::Red4);
+    GpuProfiler::Zone gpuZone(gpuProfiler.get(), "hiz build");
+
+    hizBuildProg->Bind();
+    bindTex2D(0, T.hizTex);
+    hizBuildProg->SetUniform(hizBuildUniforms.srcDepthTexture, 0);
+
+    for (int level = 1; level < T.hizLevels; level++) {
+        int w = std::max(width >> level, 1);
+        int h = std::max(height >> level, 1);
+        hizBuildProg->SetUniform(hizBuildUniforms.srcLevel, level - 1);
+        glBindImageTexture(0, T.hizTex->GetObj(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((w + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE, (h + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    GL_ERROR_CHECK("SplatRenderer::BuildHiZ()");
+}
+
+void SplatRenderer::RenderNearSplats()
+{
+    ZoneScopedNC("near splats", tracy::Color::Red4);
+    GpuProfiler::Zone gpuZone(gpuProfiler.get(), "near splats");
+
+    if (sortCount == 0) {
+        return;
+    }
+
+    // same view as the far splats, already in viewUniforms
+    nearSplatProg->Bind();
+
+    // every near splat is in front of every far one, blend them back to front over the
+    // stochastic image without testing against its depth, the same order AB would use
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    nearSplatVao->Bind();
+    {
+        GpuProfiler::StatsRange statsRange(gpuProfiler.get());
+        glDrawElements(GL_POINTS, sortCount, GL_UNSIGNED_INT, nullptr);
+    }
+    nearSplatVao->Unbind();
+
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    GL_ERROR_CHECK("SplatRenderer::RenderNearSplats()");
 }
 
-void SplatRenderer::BuildVertexArrayObject(std::shared_ptr<GaussianCloud> gaussianCloud)
+bool SplatRenderer::SetOverdrawHeatmap(bool enable)
 {
-    splatVao = std::make_shared<VertexArrayObject>();
+#ifdef __ANDROID__
+    if (enable) {
+        Log::W("The overdraw heatmap is not supported on gles\n");
+        return false;
+    }
+#endif
+    if (enable == overdraw) {
+        return true;
+    }
+
+    ZoneScopedNC("SplatRenderer::SetOverdrawHeatmap()", tracy::Color::Blue);
+
+    if (enable && !overdrawProg) {
+        overdrawProg = std::make_shared<Program>();
+        if (!overdrawProg->LoadVertFrag("shader/stencil_mask_vert.glsl", "shader/overdraw_frag.glsl")) {
+            Log::E("Error loading overdraw shaders!\n");
+            overdrawProg.reset();
+            return false;
+        }
+        overdrawHistogramVec.assign(OVERDRAW_HISTOGRAM_SIZE, 0);
+        overdrawHistogramBuffer = std::make_shared<BufferObject>(GL_SHADER_STORAGE_BUFFER, overdrawHistogramVec,
+                                                                 GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
+        // the heatmap is a fullscreen triangle from gl_VertexID
+        glGenVertexArrays(1, &overdrawVAO);
+    }
+
+    // the splat programs of every mode are built with or without the counter
+    overdraw = enable;
+    modeCache.clear();
+    std::string mode = renderMode;
+    splatProg.reset();
+    if (!SetRenderMode(mode)) {
+        return false;
+    }
+
+    if (!enable) {
+        overdrawTex.reset();
+        overdrawTexSize = glm::ivec2(0, 0);
+        overdrawProg.reset();
+        overdrawHistogramBuffer.reset();
+        overdrawHistogramVec.clear();
+        glDeleteVertexArrays(1, &overdrawVAO);
+        overdrawVAO = 0;
+    }
+    return true;
+}
+
+void SplatRenderer::BeginOverdraw(const glm::vec4& viewport)
+{
+#ifndef __ANDROID__
+    // counted at window coordinates, so the texture also covers the viewport offset
+    glm::ivec2 size((int)(viewport.x + viewport.z), (int)(viewport.y + viewport.w));
+    if (size != overdrawTexSize) {
+        Texture::Params texParams;
+        texParams.magFilter = FilterType::Nearest;
+        texParams.minFilter = FilterType::Nearest;
+        texParams.sWrap = WrapType::ClampToEdge;
+        texParams.tWrap = WrapType::ClampToEdge;
+        overdrawTex = std::make_shared<Texture>(size.x, size.y, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, texParams);
+        overdrawTexSize = size;
+    }
+
+    const uint32_t zero = 0;
+    glClearTexImage(overdrawTex->GetObj(), 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    // units 0 to 2 belong to the TAA resolve
+    glBindImageTexture(3, overdrawTex->GetObj(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+#endif
+}
+
+void SplatRenderer::DrawOverdrawHeatmap(const glm::vec4& viewport)
+{
+    ZoneScopedNC("overdraw heatmap", tracy::Color::Red4);
+
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    std::fill(overdrawHistogramVec.begin(), overdrawHistogramVec.end(), 0);
+    overdrawHistogramBuffer->Update(overdrawHistogramVec);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, overdrawHistogramBuffer->GetObj());
+
+    // drawn over whatever the splats were presented to
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glViewport((GLint)viewport.x, (GLint)viewport.y, (GLint)viewport.z, (GLint)viewport.w);
+
+    overdrawProg->Bind();
+    overdrawProg->SetUniform(overdrawUniforms.maxCount, OVERDRAW_MAX_COUNT);
+    glBindVertexArray(overdrawVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    // the histogram is read back and cleared with buffer calls
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+
+    GL_ERROR_CHECK("SplatRenderer::DrawOverdrawHeatmap()");
+}
+
+SplatRenderer::OverdrawStats SplatRenderer::ReadOverdrawStats()
+{
+    OverdrawStats stats;
+    if (!overdraw) {
+        return stats;
+    }
+
+    overdrawHistogramBuffer->Read(overdrawHistogramVec);
+
+    uint64_t fragmentSum = 0;
+    for (uint32_t count = 1; count < OVERDRAW_HISTOGRAM_SIZE; count++) {
+        stats.coveredPixels += overdrawHistogramVec[count];
+        fragmentSum += (uint64_t)count * overdrawHistogramVec[count];
+        if (overdrawHistogramVec[count] > 0) {
+            stats.max = count;
+        }
+    }
+    if (stats.coveredPixels == 0) {
+        return stats;
+    }
+    stats.mean = (double)fragmentSum / stats.coveredPixels;
+
+    // nearest rank, like the benchmark
+    auto percentile = [this, &stats](double p) {
+        uint64_t rank = std::max((uint64_t)std::ceil(p * stats.coveredPixels), (uint64_t)1);
+        uint64_t seen = 0;
+        for (uint32_t count = 1; count < OVERDRAW_HISTOGRAM_SIZE; count++) {
+            seen += overdrawHistogramVec[count];
+            if (seen >= rank) {
+                return count;
+            }
+        }
+        return OVERDRAW_HISTOGRAM_SIZE - 1;
+    };
+    stats.p50 = percentile(0.5);
+    stats.p95 = percentile(0.95);
+    return stats;
+}
+
+bool SplatRenderer::BuildSplatBuffers()
+{
+    // a temporary copy if the cloud has released its own, e.g. for a second renderer
+    std::shared_ptr<const void> data = gaussianCloud->FetchData();
+    if (!data)
+    {
+        Log::E("SplatRenderer: the splats could not be fetched\n");
+        return false;
+    }
 
     // allocate large buffer to hold interleaved vertex data
-    gaussianDataBuffer = std::make_shared<BufferObject>(GL_ARRAY_BUFFER,
-                                                        gaussianCloud->GetRawDataPtr(),
+    gaussianDataBuffer = std::make_shared<BufferObject>(GL_ARRAY_BUFFER, const_cast<void*>(data.get()),
                                                         gaussianCloud->GetTotalSize(), 0);
 
-    const size_t numGaussians = gaussianCloud->GetNumGaussians();
-
     // build element array
-    indexVec.reserve(numGaussians);
-    assert(numGaussians <= std::numeric_limits<uint32_t>::max());
-    for (uint32_t i = 0; i < (uint32_t)numGaussians; i++)
     {
-        indexVec.push_back(i);
+        SeedVectorBytes seedBytes(numGaussians * sizeof(uint32_t));
+        indexBuffer = std::make_shared<BufferObject>(GL_ELEMENT_ARRAY_BUFFER, MakeIndexVec(numGaussians), GL_DYNAMIC_STORAGE_BIT);
     }
-    auto indexBuffer = std::make_shared<BufferObject>(GL_ELEMENT_ARRAY_BUFFER, indexVec, GL_DYNAMIC_STORAGE_BIT);
 
-    splatVao->Bind();
-    gaussianDataBuffer->Bind();
+    // the culling pass reads positions and covariances straight from the interleaved data
+    splatStride = (uint32_t)(gaussianCloud->GetStride() / sizeof(float));
+    posOffset = (uint32_t)(gaussianCloud->GetPosWithAlphaAttrib().offset / sizeof(float));
+    cov0Offset = (uint32_t)(gaussianCloud->GetCov3_Col0Attrib().offset / sizeof(float));
+    cov1Offset = (uint32_t)(gaussianCloud->GetCov3_Col1Attrib().offset / sizeof(float));
+    cov2Offset = (uint32_t)(gaussianCloud->GetCov3_Col2Attrib().offset / sizeof(float));
+    return true;
+}
 
-    const size_t stride = gaussianCloud->GetStride();
-    SetupAttrib(splatProg->GetAttribLoc("position"), gaussianCloud->GetPosWithAlphaAttrib(), 4, stride);
-    SetupAttrib(splatProg->GetAttribLoc("r_sh0"), gaussianCloud->GetR_SH0Attrib(), 4, stride);
-    SetupAttrib(splatProg->GetAttribLoc("g_sh0"), gaussianCloud->GetG_SH0Attrib(), 4, stride);
-    SetupAttrib(splatProg->GetAttribLoc("b_sh0"), gaussianCloud->GetB_SH0Attrib(), 4, stride);
-    if (gaussianCloud->HasFullSH())
+GaussianCloud::DataFetcher SplatRenderer::GetGpuDataFetcher() const
+{
+    std::shared_ptr<BufferObject> buffer = gaussianDataBuffer;
+    return [buffer](size_t offset, size_t size, void* dataOut)
     {
-        SetupAttrib(splatProg->GetAttribLoc("r_sh1"), gaussianCloud->GetR_SH1Attrib(), 4, stride);
-        SetupAttrib(splatProg->GetAttribLoc("r_sh2"), gaussianCloud->GetR_SH2Attrib(), 4, stride);
-        SetupAttrib(splatProg->GetAttribLoc("r_sh3"), gaussianCloud->GetR_SH3Attrib(), 4, stride);
-        SetupAttrib(splatProg->GetAttribLoc("g_sh1"), gaussianCloud->GetG_SH1Attrib(), 4, stride);
-        SetupAttrib(splatProg->GetAttribLoc("g_sh2"), gaussianCloud->GetG_SH2Attrib(), 4, stride);
-        SetupAttrib(splatProg->GetAttribLoc("g_sh3"), gaussianCloud->GetG_SH3Attrib(), 4, stride);
-        SetupAttrib(splatProg->GetAttribLoc("b_sh1"), gaussianCloud->GetB_SH1Attrib(), 4, stride);
-        SetupAttrib(splatProg->GetAttribLoc("b_sh2"), gaussianCloud->GetB_SH2Attrib(), 4, stride);
-        SetupAttrib(splatProg->GetAttribLoc("b_sh3"), gaussianCloud->GetB_SH3Attrib(), 4, stride);
-    }
-    SetupAttrib(splatProg->GetAttribLoc("cov3_col0"), gaussianCloud->GetCov3_Col0Attrib(), 3, stride);
-    SetupAttrib(splatProg->GetAttribLoc("cov3_col1"), gaussianCloud->GetCov3_Col1Attrib(), 3, stride);
-    SetupAttrib(splatProg->GetAttribLoc("cov3_col2"), gaussianCloud->GetCov3_Col2Attrib(), 3, stride);
-
-    splatVao->SetElementBuffer(indexBuffer);
-    gaussianDataBuffer->Unbind();
+        // a bounded staging buffer, a full copy of a large scene would double its gpu memory
+        const size_t MAX_READ_SIZE = 64 * 1024 * 1024;
+        uint8_t* ptr = (uint8_t*)dataOut;
+        for (size_t done = 0; done < size; done += MAX_READ_SIZE)
+        {
+            if (!buffer->Read(offset + done, std::min(MAX_READ_SIZE, size - done), ptr + done))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
 }
 
-void SplatRenderer::drawFullscreenQuad()
+void SplatRenderer::BuildVertexArrayObject(ModePrograms& mp)
 {
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6); 
+    mp.splatVao = std::make_shared<VertexArrayObject>();
+    mp.splatVao->Bind();
+    gaussianDataBuffer->Bind();
+    SetupSplatAttribs(mp.splatProg, gaussianCloud);
+    // Sort() and CullSplats() write into the element buffer, the identity indices the other
+    // modes draw are kept apart from it
+    std::shared_ptr<BufferObject> elementBuffer = indexBuffer;
+    if (useDepthSort) {
+        elementBuffer = sortedIndexBuffer;
+    } else if (cullSplats) {
+        elementBuffer = culledIndexBuffer;
+    }
+    mp.splatVao->SetElementBuffer(elementBuffer);
+
+    if (mp.nearSplatProg)
+    {
+        // linked separately, so its attribute locations may differ, the element buffer is shared
+        mp.nearSplatVao = std::make_shared<VertexArrayObject>();
+        mp.nearSplatVao->Bind();
+        gaussianDataBuffer->Bind();
+        SetupSplatAttribs(mp.nearSplatProg, gaussianCloud);
+        mp.nearSplatVao->SetElementBuffer(elementBuffer);
+    }
+    gaussianDataBuffer->Unbind();
+    // modes can be built mid frame, keep the new VAOs out of other renderers' way
     glBindVertexArray(0);
 }
 
@@ -609,72 +1402,136 @@ void SplatRenderer::bindTex2D(int loc, const std::shared_ptr<Texture>& tex)
     glBindTexture(GL_TEXTURE_2D, tex->GetObj());
 }
 
-void SplatRenderer::runWarpPass(
+void SplatRenderer::runResolvePass(
+    const EyeTemporalTextures& T,
     const std::shared_ptr<Texture>& inAvg,
-    const std::shared_ptr<Texture>& inXYZ,
+    const std::shared_ptr<Texture>& inPos,
     const std::shared_ptr<Texture>& outAvg,
-    const std::shared_ptr<Texture>& outXYZ,
-    const glm::mat4& pv)
-{
-    static const GLfloat ZEROS[4] = {0,0,0,0};
-    glClearTexImage(outAvg->GetObj(), 0, GL_RGBA, GL_FLOAT, ZEROS);
-    glClearTexImage(outXYZ->GetObj(), 0, GL_RGBA, GL_FLOAT, ZEROS);
+    const std::shared_ptr<Texture>& outPos,
+    const EyeTemporalState& state,
+    bool viewChanged,
+    bool historyValid,
+    bool refine)
+{     
+    // the current view matrices (state.pvmat) come from viewUniforms
+    resolveProg->Bind();
+    resolveProg->SetUniform(resolveUniforms.prevProjViewMat, state.prev_pvmat);
+    resolveProg->SetUniform(resolveUniforms.viewChanged,     viewChanged);
+    resolveProg->SetUniform(resolveUniforms.historyValid,    historyValid);
+
+    bindTex2D(0, T.currentFrameTex); resolveProg->SetUniform(resolveUniforms.currentColorTexture, 0);
+    if (compactTaa) {
+        bindTex2D(1, inPos);         resolveProg->SetUniform(resolveUniforms.historyDepthTexture, 1);
+        resolveProg->SetUniform(resolveUniforms.depthParams, state.depthParams);
+        resolveProg->SetUniform(resolveUniforms.prevInvProjViewMat, glm::inverse(state.prev_pvmat));
+    } else {
+        bindTex2D(1, inPos);         resolveProg->SetUniform(resolveUniforms.historyXYZTexture,   1);
+    }
+    bindTex2D(2, T.depthTex);        resolveProg->SetUniform(resolveUniforms.currentDepthTexture, 2);
+    bindTex2D(3, inAvg);             resolveProg->SetUniform(resolveUniforms.historyColorTexture, 3);
 
-    warpProg->Bind();
-    bindTex2D(0, inAvg); warpProg->SetUniform("colorTexture", 0);
-    bindTex2D(1, inXYZ); warpProg->SetUniform("xyzTexture",   1);
-    warpProg->SetUniform("currentViewMatrix", pv);
+    glBindImageTexture(0, outAvg->GetObj(), 0, GL_FALSE, 0, GL_WRITE_ONLY, compactTaa ? GL_RGBA16F : GL_RGBA32F);
+    glBindImageTexture(1, outPos->GetObj(), 0, GL_FALSE, 0, GL_WRITE_ONLY, compactTaa ? GL_R32F : GL_RGBA32F);
 
-    glBindImageTexture(0, outAvg->GetObj(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-    glBindImageTexture(1, outXYZ->GetObj(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    if (adaptivePasses > 0) {
+        bindTex2D(4, T.momentTexA);  resolveProg->SetUniform(resolveUniforms.historyMomentTexture, 4);
+        resolveProg->SetUniform(resolveUniforms.varianceThreshold, ADAPTIVE_VARIANCE_THRESHOLD);
+        resolveProg->SetUniform(resolveUniforms.refine, refine);
+        glBindImageTexture(2, T.momentTexB->GetObj(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    }
 
-    drawFullscreenQuad();
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    glDispatchCompute((width + TAA_TILE_SIZE - 1) / TAA_TILE_SIZE, (height + TAA_TILE_SIZE - 1) / TAA_TILE_SIZE, 1);
+
+    // the history is sampled next frame and blitted right away
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
 }
 
-void SplatRenderer::runAveragePass(
-    const EyeTemporalTextures& T,
-    const std::shared_ptr<Texture>& inAvg,
-    const std::shared_ptr<Texture>& inXYZ,
-    const std::shared_ptr<Texture>& outAvg,
-    const std::shared_ptr<Texture>& outXYZ,
-    const EyeTemporalState& state,
-    bool viewChanged,
-    const glm::vec4& viewport)
-{     
-    avgProg->Bind();
-    avgProg->SetUniform("invProjViewMat", glm::inverse(state.pvmat));
-    avgProg->SetUniform("viewChanged",    viewChanged);
+void SplatRenderer::swapHistory(EyeTemporalTextures& T)
+{
+    std::swap(T.warpXYZTexA, T.warpXYZTexB);
+    std::swap(T.warpDepthTexA, T.warpDepthTexB);
+    std::swap(T.warpAvgTexA, T.warpAvgTexB);
+    std::swap(T.momentTexA, T.momentTexB);
+    std::swap(T.historyFBOA, T.historyFBOB);
+}
 
-    bindTex2D(0, T.currentFrameTex); avgProg->SetUniform("currentColorTexture", 0);
-    bindTex2D(1, inXYZ);             avgProg->SetUniform("warpedXYZTexture",    1);
-    bindTex2D(2, T.depthTex);        avgProg->SetUniform("currentDepthTexture", 2);
-    bindTex2D(3, inAvg);             avgProg->SetUniform("warpedColorTexture",  3);
+void SplatRenderer::runAdaptivePass(EyeTemporalTextures& T, const EyeTemporalState& S)
+{
+    ZoneScopedNC("adaptive pass", tracy::Color::Red4);
+    GpuProfiler::Zone gpuZone(gpuProfiler.get(), "adaptive pass");
 
-    sumFBO->Bind();
-    glViewport(0, 0, (GLint)viewport.z, (GLint)viewport.w);
+    // mark the pixels whose history has not converged yet
+    T.sceneFBO->Bind();
+    if (hiz) {
+        // the occluder level was already built into the pyramid, keep it intact
+        const GLenum drawBuffer = GL_COLOR_ATTACHMENT0;
+        glDrawBuffers(1, &drawBuffer);
+    }
+    glViewport(0, 0, width, height);
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, 1, 0xff);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDisable(GL_DEPTH_TEST);
+
+    stencilMaskProg->Bind();
+    bindTex2D(0, T.warpAvgTexA); stencilMaskProg->SetUniform(stencilMaskUniforms.historyColorTexture, 0);
+    bindTex2D(1, T.momentTexA);  stencilMaskProg->SetUniform(stencilMaskUniforms.historyMomentTexture, 1);
+    stencilMaskProg->SetUniform(stencilMaskUniforms.varianceThreshold, ADAPTIVE_VARIANCE_THRESHOLD);
+    glBindVertexArray(fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    // one more stochastic sample, only shaded where the stencil is set
+    glStencilFunc(GL_EQUAL, 1, 0xff);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    splatProg->Bind();
+    SetNoiseUniforms();
+    splatVao->Bind();
+    {
+        GpuProfiler::StatsRange statsRange(gpuProfiler.get());
+        DrawStochasticSplats();
+    }
+    splatVao->Unbind();
 
-    sumFBO->AttachColor(outAvg, GL_COLOR_ATTACHMENT0);
-    sumFBO->AttachColor(outXYZ, GL_COLOR_ATTACHMENT1);
-    const GLenum drawBufs[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, drawBufs);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_DEPTH_TEST);
+    if (hiz) {
+        const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, drawBuffers);
+    }
 
-    drawFullscreenQuad();
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    // fold it into the history, pixels outside the mask are copied through.
+    // The first resolve already moved the history into the current view, the compact depth history
+    // has to be unprojected with it, not with last frame's view
+    EyeTemporalState refineState = S;
+    refineState.prev_pvmat = S.pvmat;
+    std::shared_ptr<Texture> currPosTex = compactTaa ? T.warpDepthTexA : T.warpXYZTexA;
+    std::shared_ptr<Texture> nextPosTex = compactTaa ? T.warpDepthTexB : T.warpXYZTexB;
+    runResolvePass(T, T.warpAvgTexA, currPosTex, T.warpAvgTexB, nextPosTex, refineState, false, true, true);
+    swapHistory(T);
 }
 
-bool matricesNotEqual(const glm::mat4& a, const glm::mat4& b,
-    float epsilon = 1e-2f) {
-        for (int i = 0; i < 4; ++i) {
-            if (!glm::all(glm::lessThan(glm::abs(a[i] - b[i]), glm::vec4(epsilon))))
-                return true;
-        }
-        return false;
+void SplatRenderer::SetNoiseUniforms()
+{
+    uint32_t randomSeed = rand();
+    viewUniforms->UpdateNoise(noiseFrameIndex[activeEye]++, randomSeed);
+    splatProg->SetUniform(splatUniforms.noiseType, (int32_t)noiseType);
+    bindTex2D(0, blueNoiseTex);
+    splatProg->SetUniform(splatUniforms.blueNoise, 0);
 }
 
 void SplatRenderer::Average(const glm::vec4& viewport)
 {
     ZoneScoped;
+    GpuProfiler::Zone averageZone(gpuProfiler.get(), "average");
     GL_ERROR_CHECK("SplatRenderer::Average() begin");
     {        
         ZoneScopedNC("draw", tracy::Color::Red4);
@@ -688,40 +1545,75 @@ void SplatRenderer::Average(const glm::vec4& viewport)
         // [TODO] this threshold can be adjusted
         bool view_changed = matricesNotEqual(S.pvmat, S.prev_pvmat, 1e-3f);
 
-        std::shared_ptr<Texture> currXYZTex = T.warpXYZTexA;
-        std::shared_ptr<Texture> nextXYZTex = T.warpXYZTexB;
-        std::shared_ptr<Texture> currAvgTex = T.warpAvgTexA;
-        std::shared_ptr<Texture> nextAvgTex = T.warpAvgTexB;
-        
-        if (S.frameCount <= 1) {
-            nextXYZTex = currXYZTex;
-            nextAvgTex = currAvgTex;
-        } else if (view_changed) {
-            runWarpPass(currAvgTex, currXYZTex, nextAvgTex, nextXYZTex, S.pvmat);
-        } else {
-            std::swap(T.warpXYZTexA, T.warpXYZTexB);
-            std::swap(T.warpAvgTexA, T.warpAvgTexB);
+        // gather the history from A into B, then flip so A holds the latest average
+        std::shared_ptr<Texture> currPosTex = compactTaa ? T.warpDepthTexA : T.warpXYZTexA;
+        std::shared_ptr<Texture> nextPosTex = compactTaa ? T.warpDepthTexB : T.warpXYZTexB;
+        {
+            GpuProfiler::Zone gpuZone(gpuProfiler.get(), "warp");
+            runResolvePass(T, T.warpAvgTexA, currPosTex, T.warpAvgTexB, nextPosTex, S,
+                           view_changed, S.frameCount > 1, false);
+            swapHistory(T);
         }
 
-        runAveragePass(T, nextAvgTex, nextXYZTex, currAvgTex, currXYZTex, S, view_changed, viewport);
+        for (int pass = 0; pass < adaptivePasses; pass++) {
+            runAdaptivePass(T, S);
+        }
 
+        // present the resolved history
+        GpuProfiler::Zone gpuZone(gpuProfiler.get(), "present");
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, T.historyFBOA->fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, presentFbo);
+        const GLint x0 = (GLint)viewport.x, y0 = (GLint)viewport.y;
+        const GLint w = (GLint)viewport.z, h = (GLint)viewport.w;
+        glBlitFramebuffer(0, 0, w, h, x0, y0, x0 + w, y0 + h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
         glBindFramebuffer(GL_FRAMEBUFFER, presentFbo);
-        glViewport((GLint)viewport.x, (GLint)viewport.y, (GLint)viewport.z, (GLint)viewport.w);
-        glDisable(GL_DEPTH_TEST);
-        // display the final quad
-        displayProg->Bind();
-        bindTex2D(0, currAvgTex);
-        displayProg->SetUniform("textureSum", 0);
-        drawFullscreenQuad();
+        glViewport(x0, y0, w, h);
 
         GL_ERROR_CHECK("SplatRenderer::Average()");
     }
 }
 
+bool SplatRenderer::IsConverged() const
+{
+    // the view comparison only makes sense when a single eye is rendered
+    if (m_eyeCount != 1) {
+        return false;
+    }
+
+    if (renderMode == "AB") {
+        // sorted alpha blending is deterministic, one repeat of the same view is enough
+        return staticFrameCount >= 1;
+    } else if (taa) {
+        // more samples do not change the history once it has hit the cap
+        return staticFrameCount >= TAA_MAX_SAMPLES;
+    }
+    return false;
+}
+
+void SplatRenderer::SetNoiseType(NoiseType type)
+{
+    noiseType = type;
+    // restart the sequences, the accumulated history came from a different random source
+    std::fill(noiseFrameIndex.begin(), noiseFrameIndex.end(), 0);
+    if (renderMode != "AB" && taa) {
+        int prevEye = activeEye;
+        for (activeEye = 0; activeEye < m_eyeCount; ++activeEye) {
+            resetTemporalTextures();
+        }
+        activeEye = prevEye;
+    }
+}
+
 void SplatRenderer::resetTemporalTextures()
 {
     static const GLfloat ZEROS[4] = {0.f, 0.f, 0.f, 0.f};
 
+    staticFrameCount = 0;
+    // AB, or the TAA buffers were released
+    if (activeEye >= (int)eyeTextures.size()) {
+        return;
+    }
+
     EyeTemporalTextures& T      = eyeTextures[activeEye];
     EyeTemporalState&    state  = eyeState[activeEye];
     
@@ -734,8 +1626,12 @@ void SplatRenderer::resetTemporalTextures()
 
     clear(T.warpAvgTexA); clear(T.warpAvgTexB);
     clear(T.warpXYZTexA); clear(T.warpXYZTexB);
+    clear(T.warpDepthTexA, GL_RED); clear(T.warpDepthTexB, GL_RED);
+    clear(T.momentTexA, GL_RED); clear(T.momentTexB, GL_RED);
 
     // start fresh
+    if (activeEye < (int)noiseFrameIndex.size())
+        noiseFrameIndex[activeEye] = 0;
     state.frameCount   = 0;
     state.prev_pvmat   = state.pvmat;      // keep current for next compare
 }
@@ -748,43 +1644,23 @@ void SplatRenderer::resetTemporalTextures(int newW, int newH)
     texParams.sWrap = WrapType::ClampToEdge;
     texParams.tWrap = WrapType::ClampToEdge;
 
-    auto makeRGBA  = [&](int w, int h) {
-        return std::make_shared<Texture>(w, h,
-                                         GL_RGBA32F,  // IF
-                                         GL_RGBA,     // format
-                                         GL_FLOAT,    // type
-                                         texParams);
-    };
-    auto makeDepth = [&](int w, int h) {
-        return std::make_shared<Texture>(w, h,
-                                         GL_DEPTH_COMPONENT32F,
-                                         GL_DEPTH_COMPONENT,
-                                         GL_FLOAT,
-                                         texParams);
-    };
-
-    EyeTemporalTextures& T = eyeTextures[activeEye];
-    T.warpAvgTexA   = makeRGBA(newW, newH);
-    T.warpAvgTexB   = makeRGBA(newW, newH);
-    T.warpXYZTexA   = makeRGBA(newW, newH);
-    T.warpXYZTexB   = makeRGBA(newW, newH);
-    T.currentFrameTex = makeRGBA(newW, newH);
-    T.depthTex        = makeDepth(newW, newH);
-
-    // Re‑create / re‑attach FBO
-    T.sceneFBO = std::make_shared<FrameBuffer>();
-    T.sceneFBO->Bind();
-    T.sceneFBO->AttachColor(T.currentFrameTex, GL_COLOR_ATTACHMENT0);
-    T.sceneFBO->AttachDepth (T.depthTex);
-
-    if (!T.sceneFBO->IsComplete())
-        Log::E("sceneFBO incomplete after resize!");
-    
     // Update cached dimensions so Render() uses the correct viewport
     width  = newW;
     height = newH;
+    staticFrameCount = 0;
+    // AB, or the TAA buffers were released, they are created at this size when needed
+    if (activeEye >= (int)eyeTextures.size()) {
+        return;
+    }
+
+    // Re‑create textures and re‑attach FBO
+    EyeTemporalTextures& T = eyeTextures[activeEye];
+    if (!CreateEyeTemporalTextures(T, newW, newH, texParams))
+        Log::E("sceneFBO incomplete after resize!");
 
     // Reset per‑eye state
     EyeTemporalState& S = eyeState[activeEye];
     S.frameCount = 0;
+    if (activeEye < (int)noiseFrameIndex.size())
+        noiseFrameIndex[activeEye] = 0;
 }
@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -25,9 +27,12 @@
 #include "core/vertexbuffer.h"
 #include "core/texture.h"
 #include "core/framebuffer.h"
+#include "core/viewuniforms.h"
 
 #include "gaussiancloud.h"
 
+class GpuProfiler;
+
 namespace rgc::radix_sort
 {
     struct sorter;
@@ -42,27 +47,56 @@ public:
     SplatRenderer();
     ~SplatRenderer();
 
-    // Per-eye temporal textures for VR TAA
+    // random source for the stochastic alpha test of the ST modes
+    enum class NoiseType
+    {
+        White = 0,  // hashed per pixel, splat and frame
+        BlueNoise,  // tiled blue noise, animated over frames
+        Sobol,      // owen scrambled sobol sequence over frames
+        Count
+    };
+
+    // Per-eye temporal textures for VR TAA, A holds the latest history and B is the gather target
     struct EyeTemporalTextures {
         std::shared_ptr<Texture> warpAvgTexA;
         std::shared_ptr<Texture> warpAvgTexB;
         std::shared_ptr<Texture> warpXYZTexA;
         std::shared_ptr<Texture> warpXYZTexB;
+        // compact mode only, eye depth is stored in place of the world xyz
+        std::shared_ptr<Texture> warpDepthTexA;
+        std::shared_ptr<Texture> warpDepthTexB;
+        // adaptive sampling only, mean of the squared luminance
+        std::shared_ptr<Texture> momentTexA;
+        std::shared_ptr<Texture> momentTexB;
         std::shared_ptr<Texture> currentFrameTex;
         std::shared_ptr<Texture> depthTex;
         std::shared_ptr<FrameBuffer> sceneFBO;
+        std::shared_ptr<FrameBuffer> historyFBOA;  // warpAvgTexA attached, swapped along with it
+        std::shared_ptr<FrameBuffer> historyFBOB;
+        // occlusion culling only, farthest occluder depth per texel, level 0 is rendered with the scene
+        std::shared_ptr<Texture> hizTex;
+        int hizLevels = 0;
     };
 
     // Per-eye temporal state for VR TAA
     struct EyeTemporalState {
         glm::mat4 pvmat;
         glm::mat4 prev_pvmat;
+        glm::vec2 depthParams;  // projMat[2][2], projMat[3][2], used to convert eye depth to clip z
         int frameCount = 0;
     };
 
     bool Init(std::shared_ptr<GaussianCloud> gaussianCloud,
               bool isFramebufferSRGBEnabledIn, bool useRgcSortOverrideIn,
-              std::string renderMode, int ineyeCount, int inwidth, int inheight, bool taa);
+              std::string renderMode, int ineyeCount, int inwidth, int inheight, bool taa,
+              bool compactTaa, int adaptivePasses, int sampleMaskCount, bool hiz,
+              uint32_t splatBudget);
+
+    // switches between "AB", "ST", "ST-popfree" and "hybrid" without reloading the scene. The
+    // programs and buffers of a mode are built on first use and freed once it has been unused
+    // for a while. If the new mode fails to build the previous one is kept and false is returned.
+    bool SetRenderMode(const std::string& mode);
+    const std::string& GetRenderMode() const { return renderMode; }
 
     void Sort(const glm::mat4& cameraMat, const glm::mat4& projMat,
               const glm::vec2& nearFar);
@@ -75,6 +109,55 @@ public:
     void SetActiveEye(int eyeIndex) { activeEye = eyeIndex; }
     void SetPresentFbo(GLuint fbo) { presentFbo = fbo; }
 
+    // splats drawn and depth sorted by the last Render(), not counting adaptive passes
+    struct FrameStats
+    {
+        uint32_t drawCount = 0;
+        uint32_t sortCount = 0;
+    };
+    // when the splats are culled on the gpu their count is read back, which waits for the frame
+    FrameStats ReadFrameStats();
+
+    // true once re-rendering the same view would not change the image, the caller
+    // may keep presenting the previous frame until the camera moves.
+    bool IsConverged() const;
+
+    // expected number of splats drawn per frame when subsampling, the rest are skipped at random
+    // with their opacity reweighted, 0 draws every splat. Only has an effect if enabled in Init.
+    void SetSplatBudget(uint32_t budget);
+
+    // hybrid mode only, splats closer than this are sorted and alpha blended
+    void SetHybridNearDepth(float depth) { hybridNearDepth = depth; }
+
+    // reads the splats back from the vertex buffer Init() uploaded them to, pass it to
+    // GaussianCloud::ReleaseData() to drop the cpu copy. Needs this renderer's gl context.
+    GaussianCloud::DataFetcher GetGpuDataFetcher() const;
+
+    // gpu time of the sort and render stages is recorded into profiler while it is enabled,
+    // and the pipeline statistics of the splat draws
+    void SetGpuProfiler(std::shared_ptr<GpuProfiler> profiler) { gpuProfiler = profiler; }
+
+    // Replaces the image with a heatmap of the fragments the splat draws shaded per pixel,
+    // counted with image atomics. The splat programs of every mode are rebuilt, and the counter
+    // turns off early depth testing, so timings are not representative. Desktop gl only.
+    bool SetOverdrawHeatmap(bool enable);
+    bool GetOverdrawHeatmap() const { return overdraw; }
+
+    // fragments per pixel of the last heatmap, over the pixels at least one splat covered
+    struct OverdrawStats
+    {
+        uint32_t coveredPixels = 0;
+        double mean = 0.0;
+        uint32_t p50 = 0;
+        uint32_t p95 = 0;
+        uint32_t max = 0;  // counts above 255 are reported as 256
+    };
+    // waits for the last heatmap to be drawn
+    OverdrawStats ReadOverdrawStats();
+
+    void SetNoiseType(NoiseType type);
+    NoiseType GetNoiseType() const { return noiseType; }
+
     // Configuration methods
     void resetTemporalTextures();
     void resetTemporalTextures(int newW, int newH);
@@ -85,48 +168,98 @@ public:
 protected:
 
 private:
+    // programs that differ between render modes, the scene data and indices are shared
+    struct ModePrograms {
+        std::shared_ptr<Program> splatProg;
+        std::shared_ptr<VertexArrayObject> splatVao;
+        std::shared_ptr<Program> nearSplatProg;  // hybrid only
+        std::shared_ptr<VertexArrayObject> nearSplatVao;
+        std::shared_ptr<Program> preSortProg;  // AB and hybrid
+        std::chrono::steady_clock::time_point lastUsed;
+    };
+
     void Average(const glm::vec4& viewport);
-    void drawFullscreenQuad();
     void bindTex2D(int loc, const std::shared_ptr<Texture>& tex);
-    void runWarpPass(
-        const std::shared_ptr<Texture>& inAvg,
-        const std::shared_ptr<Texture>& inXYZ,
-        const std::shared_ptr<Texture>& outAvg,
-        const std::shared_ptr<Texture>& outXYZ,
-        const glm::mat4& pv);
-    void runAveragePass(
+    // inPos/outPos hold world xyz, or eye depth when compactTaa is enabled
+    void runResolvePass(
         const EyeTemporalTextures& T,
         const std::shared_ptr<Texture>& inAvg,
-        const std::shared_ptr<Texture>& inXYZ,
+        const std::shared_ptr<Texture>& inPos,
         const std::shared_ptr<Texture>& outAvg,
-        const std::shared_ptr<Texture>& outXYZ,
+        const std::shared_ptr<Texture>& outPos,
         const EyeTemporalState& state,
         bool viewChanged,
-        const glm::vec4& viewport);    
+        bool historyValid,
+        bool refine);
+    void swapHistory(EyeTemporalTextures& T);
+    // extra stochastic sample for the pixels whose history has not converged
+    void runAdaptivePass(EyeTemporalTextures& T, const EyeTemporalState& S);
+    // all splats, the unsorted far ones in hybrid mode or the ones CullSplats() selected,
+    // with splatProg and splatVao bound
+    void DrawStochasticSplats();
+    // writes the splats to draw this frame into the element buffer and the indirect draw
+    void CullSplats(const EyeTemporalTextures& T, const EyeTemporalState& S);
+    void BuildHiZ(const EyeTemporalTextures& T);
+    // hybrid mode, blends the sorted near splats over the stochastic image
+    void RenderNearSplats();
+    // per draw random seed, frame index and blue noise texture for the ST splat shader
+    void SetNoiseUniforms();
+    bool InitializeNoise();
 
-    void BuildVertexArrayObject(std::shared_ptr<GaussianCloud> gaussianCloud);
+    // clears the counters before the splat draws and draws them as a heatmap after
+    void BeginOverdraw(const glm::vec4& viewport);
+    void DrawOverdrawHeatmap(const glm::vec4& viewport);
+
+    // frees what the current mode does not use once it has been idle for MODE_RELEASE_DELAY
+    void ReleaseUnusedResources();
+    void ReleaseTAA();
+    void ReleaseSortingBuffers();
+
+    bool BuildSplatBuffers();
+    void BuildVertexArrayObject(ModePrograms& mp);
+    // the Initialize* functions do nothing if their resources already exist
     bool InitializeTAA();
     bool CreateTAATextureBuffers(const Texture::Params& texParams);
-    bool InitializeSortingBuffers(bool useMultiRadixSort);
-    bool LoadShader(std::string renderMode, bool useMultiRadixSort);
+    bool CreateEyeTemporalTextures(EyeTemporalTextures& T, int w, int h, const Texture::Params& texParams);
+    bool InitializeSortingBuffers();
+    bool LoadShader(ModePrograms& mp);
 
     int width = 0;
     int height = 0;
 
+    std::shared_ptr<GaussianCloud> gaussianCloud;
+    std::shared_ptr<GpuProfiler> gpuProfiler;
     std::shared_ptr<Program> splatProg;  
     std::shared_ptr<BufferObject> gaussianDataBuffer;
-       
+    std::shared_ptr<BufferObject> indexBuffer;  // identity, never written after the upload
+
+    // view, projection, viewport and noise counters of the view being rendered, read by the
+    // splat, cull and resolve shaders
+    std::shared_ptr<ViewUniforms> viewUniforms;
+
+    // programs of the modes used so far, splatProg and friends point into the current one
+    std::map<std::string, ModePrograms> modeCache;
+    std::chrono::steady_clock::time_point sortLastUsed;
+    std::chrono::steady_clock::time_point taaLastUsed;
+
     std::string renderMode = "AB";
     size_t numGaussians;
+    // AB sorts all visible splats, hybrid only the ones closer than hybridNearDepth
+    bool useDepthSort = false;
+    bool hybrid = false;
+
+    // ST with a per sample coverage mask, number of MSAA samples of the target (0 = off)
+    int sampleMaskCount = 0;
+
+    NoiseType noiseType = NoiseType::White;
+    std::shared_ptr<Texture> blueNoiseTex;
+    std::vector<uint32_t> noiseFrameIndex;  // per eye, low discrepancy sequences need consecutive indices
 
     // AB parameters
     uint32_t sortCount;
     bool isFramebufferSRGBEnabled;
     bool useRgcSortOverride;
 
-    std::vector<uint32_t> indexVec;
-    std::vector<uint32_t> depthVec;
-    std::vector<glm::vec4> posVec;
     std::vector<uint32_t> atomicCounterVec;
 
     std::shared_ptr<rgc::radix_sort::sorter> sorter;
@@ -141,6 +274,14 @@ private:
     std::shared_ptr<BufferObject> valBuffer2;
     std::shared_ptr<BufferObject> posBuffer;
     std::shared_ptr<BufferObject> atomicCounterBuffer;
+
+    // hybrid mode, near splats use the AB shaders, far ones the ST shaders in splatProg
+    float hybridNearDepth = 2.0f;
+    uint32_t farCount = 0;
+    std::shared_ptr<Program> nearSplatProg;
+    std::shared_ptr<VertexArrayObject> nearSplatVao;
+    std::shared_ptr<BufferObject> farIndexBuffer;
+    std::shared_ptr<BufferObject> sortedIndexBuffer;  // element buffer of AB and hybrid, written by Sort()
     
     
     // VR state
@@ -150,15 +291,113 @@ private:
     std::vector<EyeTemporalTextures> eyeTextures;
     std::vector<EyeTemporalState> eyeState; 
 
+    // idle detection, consecutive frames rendered from the same view
+    glm::mat4 lastPvmat = glm::mat4(0.0f);
+    int staticFrameCount = 0;
+
     // TAA params
     bool taa = false;
-    std::shared_ptr<Program> avgProg;
-    std::shared_ptr<Program> displayProg;
-    std::shared_ptr<Program> warpProg;
+    // RGBA16F history (sample count in alpha) + R32F eye depth, instead of RGBA32F color + xyz
+    bool compactTaa = false;
+    std::shared_ptr<Program> resolveProg;
+
+    // adaptive sampling, number of stencil masked passes per frame (0 = off)
+    int adaptivePasses = 0;
+    std::shared_ptr<Program> stencilMaskProg;
+
+    // per frame splat selection in a compute pass, needed for hiz or subsampling
+    bool cullSplats = false;
+    std::shared_ptr<Program> cullProg;
+    // hierarchical z occlusion culling against the previous frame, hizRequested is the Init
+    // option, hiz whether the current mode uses it
+    bool hizRequested = false;
+    bool hiz = false;
+    std::shared_ptr<Program> hizBuildProg;
+    // stochastic subsampling, splat opacities ascending and the keep probability parameters
+    bool subsampleRequested = false;
+    bool subsample = false;
+    uint32_t splatBudget = 0;
+    std::vector<float> sortedAlphaVec;
+    std::vector<double> alphaSuffixSumVec;  // [i] is the sum of sortedAlphaVec from i on, one longer
+    glm::vec2 subsampleParams = glm::vec2(1.0f, 1.0f);
+    std::shared_ptr<BufferObject> drawCommandBuffer;
+    std::shared_ptr<BufferObject> culledIndexBuffer;  // element buffer of the culled modes, written by CullSplats()
+    std::vector<uint32_t> drawCommandVec;
+    // overdraw heatmap, fragment count per pixel in window coordinates and its histogram
+    bool overdraw = false;
+    std::shared_ptr<Texture> overdrawTex;
+    glm::ivec2 overdrawTexSize = glm::ivec2(0, 0);
+    std::shared_ptr<Program> overdrawProg;
+    std::shared_ptr<BufferObject> overdrawHistogramBuffer;
+    std::vector<uint32_t> overdrawHistogramVec;
+    GLuint overdrawVAO = 0;
+    // layout of the interleaved gaussian data, in floats
+    uint32_t splatStride = 0;
+    uint32_t posOffset = 0;
+    uint32_t cov0Offset = 0;
+    uint32_t cov1Offset = 0;
+    uint32_t cov2Offset = 0;
+    GLuint fullscreenVAO = 0;
     std::shared_ptr<VertexArrayObject> splatVao;   
 
-    GLuint quadVAO = 0, quadVBO = 0;
-    std::shared_ptr<FrameBuffer> sumFBO;
+    // uniforms set every frame, looked up once per program instead of by name on every call
+    struct SplatUniforms {
+        Program::Uniform<int32_t> noiseType{"u_noiseType"};
+        Program::Uniform<int32_t> blueNoise{"u_blueNoise"};
+        Program::Uniform<glm::vec2> subsampleParams{"subsampleParams"};
+    } splatUniforms;
+    struct PreSortUniforms {
+        Program::Uniform<glm::mat4> modelViewProj{"modelViewProj"};
+        Program::Uniform<glm::vec2> nearFar{"nearFar"};
+        Program::Uniform<uint32_t> keyMax{"keyMax"};
+    } preSortUniforms;
+    struct RadixSortUniforms {
+        Program::Uniform<uint32_t> numElements{"g_num_elements"};
+        Program::Uniform<uint32_t> numWorkgroups{"g_num_workgroups"};
+        Program::Uniform<uint32_t> numBlocksPerWorkgroup{"g_num_blocks_per_workgroup"};
+        Program::Uniform<uint32_t> shift{"g_shift"};
+    } sortUniforms, histogramUniforms;
+    struct CullUniforms {
+        Program::Uniform<uint32_t> numSplats{"numSplats"};
+        Program::Uniform<uint32_t> splatStride{"splatStride"};
+        Program::Uniform<uint32_t> posOffset{"posOffset"};
+        Program::Uniform<uint32_t> cov0Offset{"cov0Offset"};
+        Program::Uniform<uint32_t> cov1Offset{"cov1Offset"};
+        Program::Uniform<uint32_t> cov2Offset{"cov2Offset"};
+        Program::Uniform<glm::mat4> hizViewProjMat{"hizViewProjMat"};
+        Program::Uniform<bool> occlusionTest{"occlusionTest"};
+        Program::Uniform<int32_t> hizMaxLevel{"hizMaxLevel"};
+        Program::Uniform<int32_t> hizTexture{"hizTexture"};
+        Program::Uniform<glm::vec2> subsampleParams{"subsampleParams"};
+        Program::Uniform<uint32_t> frameSeed{"frameSeed"};
+    } cullUniforms;
+    struct HiZBuildUniforms {
+        Program::Uniform<int32_t> srcDepthTexture{"srcDepthTexture"};
+        Program::Uniform<int32_t> srcLevel{"srcLevel"};
+    } hizBuildUniforms;
+    struct ResolveUniforms {
+        Program::Uniform<glm::mat4> prevProjViewMat{"prevProjViewMat"};
+        Program::Uniform<glm::mat4> prevInvProjViewMat{"prevInvProjViewMat"};
+        Program::Uniform<glm::vec2> depthParams{"depthParams"};
+        Program::Uniform<bool> viewChanged{"viewChanged"};
+        Program::Uniform<bool> historyValid{"historyValid"};
+        Program::Uniform<bool> refine{"refine"};
+        Program::Uniform<float> varianceThreshold{"varianceThreshold"};
+        Program::Uniform<int32_t> currentColorTexture{"currentColorTexture"};
+        Program::Uniform<int32_t> currentDepthTexture{"currentDepthTexture"};
+        Program::Uniform<int32_t> historyColorTexture{"historyColorTexture"};
+        Program::Uniform<int32_t> historyDepthTexture{"historyDepthTexture"};
+        Program::Uniform<int32_t> historyXYZTexture{"historyXYZTexture"};
+        Program::Uniform<int32_t> historyMomentTexture{"historyMomentTexture"};
+    } resolveUniforms;
+    struct OverdrawUniforms {
+        Program::Uniform<float> maxCount{"maxCount"};
+    } overdrawUniforms;
+    struct StencilMaskUniforms {
+        Program::Uniform<int32_t> historyColorTexture{"historyColorTexture"};
+        Program::Uniform<int32_t> historyMomentTexture{"historyMomentTexture"};
+        Program::Uniform<float> varianceThreshold{"varianceThreshold"};
+    } stencilMaskUniforms;
 };
 
 }
\ No newline at end of file